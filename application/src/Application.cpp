@@ -2,6 +2,7 @@
 
 #include "Application.h"
 #include "ApplicationContext.h"
+#include "BuildScheduler.h"
 #include "CameraSystem.h"
 #include "GeodataContext.h"
 #include "GeodataSystem.h"
@@ -10,12 +11,14 @@
 #include "RenderingSystem.h"
 #include "UIContext.h"
 #include "UISystem.h"
+#include "UnrealLoader.h"
 #include "WindowContext.h"
 #include "WindowSystem.h"
 
 Application::Application() {}
 
 void Application::preview(const std::filesystem::path &client_root,
+                          const unreal::CacheConfig &cache_config,
                           const std::vector<std::string> &maps) const {
 
   // Make sure to remove systems & contexts before OpenGL context will be
@@ -29,6 +32,7 @@ void Application::preview(const std::filesystem::path &client_root,
     GeodataContext geodata_context{};
 
     Renderer renderer{rendering_context};
+    UnrealLoader unreal_loader{client_root, cache_config};
 
     // Initialize systems
     std::vector<std::unique_ptr<System>> systems;
@@ -42,7 +46,7 @@ void Application::preview(const std::filesystem::path &client_root,
     systems.push_back(
         std::make_unique<CameraSystem>(rendering_context, window_context));
     systems.push_back(std::make_unique<LoadingSystem>(
-        geodata_context, &renderer, client_root, maps));
+        geodata_context, &renderer, unreal_loader, maps));
     systems.push_back(std::make_unique<GeodataSystem>(geodata_context,
                                                       ui_context, &renderer));
 
@@ -77,20 +81,30 @@ void Application::preview(const std::filesystem::path &client_root,
 }
 
 void Application::build(const std::filesystem::path &client_root,
+                        const unreal::CacheConfig &cache_config,
+                        const BuildConfig &build_config,
                         const std::vector<std::string> &maps) const {
 
-  for (const auto &map : maps) {
-    UIContext ui_context{};
-    GeodataContext geodata_context{};
+  // Packages and static meshes are shared between maps, so they are loaded
+  // once per run instead of once per map. Only geometry is loaded for build.
+  UnrealLoader unreal_loader{client_root, cache_config,
+                             build_config.simple_collision};
 
-    LoadingSystem loading_system{geodata_context, nullptr, client_root, {map}};
-    GeodataSystem geodata_system{geodata_context, ui_context, nullptr};
+  UIContext ui_context{};
+  ui_context.geodata.set_defaults();
 
-    ui_context.geodata.set_defaults();
+  const BuildScheduler build_scheduler{unreal_loader,
+                                       ui_context.geodata.builder_settings(),
+                                       cache_config, build_config};
 
-    ui_context.geodata.should_export = true;
-    ui_context.geodata.build_handler();
-  }
+  build_scheduler.build(maps);
+
+  const auto package_statistics = unreal_loader.package_statistics();
+  const auto mesh_statistics = unreal_loader.mesh_statistics();
+
+  utils::Log(utils::LOG_INFO, "App")
+      << "Reused " << package_statistics.hits << " packages and "
+      << mesh_statistics.hits << " static meshes" << std::endl;
 
   std::cout << "Done!" << std::endl;
 }
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "BuildConfig.h"
+
+#include <unreal/ArchiveLoader.h>
+
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -9,7 +13,10 @@ public:
   explicit Application();
 
   void preview(const std::filesystem::path &client_root,
+               const unreal::CacheConfig &cache_config,
                const std::vector<std::string> &maps) const;
   void build(const std::filesystem::path &client_root,
+             const unreal::CacheConfig &cache_config,
+             const BuildConfig &build_config,
              const std::vector<std::string> &maps) const;
 };
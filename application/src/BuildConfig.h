@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+struct BuildConfig {
+  // Builder settings overridden by a sweep entry
+  struct SweepSettings {
+    float actor_height;
+    float actor_radius;
+    float min_walkable_climb;
+    float max_walkable_climb;
+  };
+
+  // Maps built concurrently
+  std::size_t jobs;
+
+  // Memory limit for geodata building in bytes (0 - unlimited)
+  std::size_t memory_limit;
+
+  // Rebuild maps even if their inputs didn't change since the last build
+  bool force;
+
+  // Prebuilt maps are cached here, unless it's empty
+  std::filesystem::path map_cache;
+
+  // Every map is built with each of these settings, unless it's empty
+  std::vector<SweepSettings> sweep;
+
+  // Static meshes collide with their collision models where they have ones
+  bool simple_collision;
+};
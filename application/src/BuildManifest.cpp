@@ -0,0 +1,215 @@
+#include "pch.h"
+
+#include "BuildManifest.h"
+
+// Bump when changes of the converter affect generated geodata
+static constexpr std::uint32_t CONVERTER_VERSION = 1;
+
+static constexpr auto MANIFEST_HEADER = "l2mapconv-manifest 2";
+
+static auto settings_fingerprint(const geodata::BuilderSettings &settings)
+    -> std::string {
+
+  std::ostringstream output;
+  output.precision(std::numeric_limits<float>::max_digits10);
+
+  output << settings.actor_height << " "
+         << settings.actor_radius << " " << settings.max_walkable_angle << " "
+         << settings.min_walkable_climb << " " << settings.max_walkable_climb
+         << " " << settings.cell_size << " " << settings.cell_height;
+
+  return output.str();
+}
+
+BuildManifest::BuildManifest(const std::filesystem::path &path,
+                             const UnrealLoader &unreal_loader,
+                             const geodata::BuilderSettings &settings)
+    : m_path{path}, m_unreal_loader{unreal_loader},
+      m_collision{unreal_loader.simple_collision() ? "simple" : "triangles"},
+      m_settings{settings_fingerprint(settings)}, m_entries{} {
+
+  load();
+}
+
+auto BuildManifest::is_up_to_date(
+    const std::string &map_name,
+    const std::filesystem::path &output_path) const -> bool {
+
+  const std::lock_guard lock{m_mutex};
+
+  const auto entry = m_entries.find(map_name);
+
+  return entry != m_entries.end() && entry->second.settings == m_settings &&
+         has_unchanged_sources(entry->second) &&
+         std::filesystem::exists(output_path);
+}
+
+auto BuildManifest::sources(const std::vector<std::string> &packages) const
+    -> geodata::MapCache::Sources {
+
+  geodata::MapCache::Sources sources{CONVERTER_VERSION, m_collision, {}};
+
+  for (const auto &package : packages) {
+    const auto current = fingerprint(package);
+    sources.files.push_back({current.name, current.size, current.modified});
+  }
+
+  return sources;
+}
+
+auto BuildManifest::has_unchanged_sources(
+    const geodata::MapCache::Sources &sources) const -> bool {
+
+  if (sources.loader_version != CONVERTER_VERSION ||
+      sources.loader_options != m_collision) {
+
+    return false;
+  }
+
+  for (const auto &file : sources.files) {
+    const auto current = fingerprint(file.name);
+
+    if (current.size != file.size || current.modified != file.modified) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto BuildManifest::has_unchanged_sources(const Entry &entry) const -> bool {
+  if (entry.version != static_cast<int>(CONVERTER_VERSION) ||
+      entry.collision != m_collision) {
+
+    return false;
+  }
+
+  for (const auto &package : entry.packages) {
+    const auto current = fingerprint(package.name);
+
+    if (current.size != package.size || current.modified != package.modified) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void BuildManifest::update(const std::string &map_name,
+                           const std::vector<std::string> &packages) const {
+
+  Entry entry{CONVERTER_VERSION, m_collision, m_settings, {}};
+
+  for (const auto &package : packages) {
+    entry.packages.push_back(fingerprint(package));
+  }
+
+  const std::lock_guard lock{m_mutex};
+  m_entries.insert_or_assign(map_name, std::move(entry));
+  save();
+}
+
+auto BuildManifest::fingerprint(const std::string &package) const
+    -> PackageFingerprint {
+
+  const auto *file = m_unreal_loader.find_package(package);
+
+  // Missing package has zero fingerprint, so the map is rebuilt once the
+  // package appears
+  if (file == nullptr) {
+    return {package, 0, 0};
+  }
+
+  return {package, file->size,
+          static_cast<std::int64_t>(file->modified.time_since_epoch().count())};
+}
+
+void BuildManifest::load() {
+  std::ifstream input{m_path};
+
+  if (!input) {
+    return;
+  }
+
+  std::string line;
+
+  if (!std::getline(input, line) || line != MANIFEST_HEADER) {
+    utils::Log(utils::LOG_WARN, "App")
+        << "Unknown build manifest format, rebuilding all maps: " << m_path
+        << std::endl;
+    return;
+  }
+
+  Entry *entry = nullptr;
+
+  while (std::getline(input, line)) {
+    std::istringstream fields{line};
+    std::string type;
+    fields >> type;
+
+    if (type == "map") {
+      std::string map_name;
+      fields >> map_name;
+      entry = &m_entries[map_name];
+    } else if (type == "version" && entry != nullptr) {
+      fields >> entry->version;
+    } else if (type == "collision" && entry != nullptr) {
+      fields >> entry->collision;
+    } else if (type == "settings" && entry != nullptr) {
+      fields >> std::ws;
+      std::getline(fields, entry->settings);
+    } else if (type == "package" && entry != nullptr) {
+      PackageFingerprint package{};
+      fields >> package.name >> package.size >> package.modified;
+      entry->packages.push_back(std::move(package));
+    }
+  }
+}
+
+void BuildManifest::save() const {
+  std::vector<std::string> map_names;
+
+  for (const auto &[map_name, entry] : m_entries) {
+    map_names.push_back(map_name);
+  }
+
+  std::sort(map_names.begin(), map_names.end());
+
+  // Write to a temporary file first, so an interrupted build doesn't leave
+  // a truncated manifest
+  auto temporary_path = m_path;
+  temporary_path += ".tmp";
+
+  {
+    std::ofstream output{temporary_path};
+    output << MANIFEST_HEADER << "\n";
+
+    for (const auto &map_name : map_names) {
+      const auto &entry = m_entries.at(map_name);
+
+      output << "map " << map_name << "\n";
+      output << "version " << entry.version << "\n";
+      output << "collision " << entry.collision << "\n";
+      output << "settings " << entry.settings << "\n";
+
+      for (const auto &package : entry.packages) {
+        output << "package " << package.name << " " << package.size << " "
+               << package.modified << "\n";
+      }
+    }
+
+    if (!output) {
+      utils::Log(utils::LOG_WARN, "App")
+          << "Can't write build manifest: " << temporary_path << std::endl;
+      return;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary_path, m_path, error);
+
+  if (error) {
+    utils::Log(utils::LOG_WARN, "App")
+        << "Can't write build manifest: " << m_path << std::endl;
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "UnrealLoader.h"
+
+#include <geodata/BuilderSettings.h>
+#include <geodata/MapCache.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Remembers inputs of exported maps: client packages the map was loaded from,
+// the collision mode, builder settings and the converter version. Maps with
+// unchanged inputs and existing output don't have to be rebuilt.
+class BuildManifest {
+public:
+  explicit BuildManifest(const std::filesystem::path &path,
+                         const UnrealLoader &unreal_loader,
+                         const geodata::BuilderSettings &settings);
+
+  // Sources and settings didn't change and the output exists
+  auto is_up_to_date(const std::string &map_name,
+                     const std::filesystem::path &output_path) const -> bool;
+
+  // Current fingerprints of the packages, with the converter version and the
+  // collision mode, stored with cached maps
+  auto sources(const std::vector<std::string> &packages) const
+      -> geodata::MapCache::Sources;
+
+  // Packages and the converter didn't change, so the map loaded from them
+  // would be the same
+  auto has_unchanged_sources(const geodata::MapCache::Sources &sources) const
+      -> bool;
+
+  // Records inputs of the exported map and saves the manifest
+  void update(const std::string &map_name,
+              const std::vector<std::string> &packages) const;
+
+private:
+  struct PackageFingerprint {
+    std::string name;
+    std::uintmax_t size;
+    std::int64_t modified;
+  };
+
+  struct Entry {
+    int version;
+    std::string collision;
+    std::string settings;
+    std::vector<PackageFingerprint> packages;
+  };
+
+  const std::filesystem::path m_path;
+  const UnrealLoader &m_unreal_loader;
+  const std::string m_collision;
+  const std::string m_settings;
+
+  mutable std::mutex m_mutex;
+  mutable std::unordered_map<std::string, Entry> m_entries;
+
+  auto fingerprint(const std::string &package) const -> PackageFingerprint;
+
+  // Must be called with the mutex locked
+  auto has_unchanged_sources(const Entry &entry) const -> bool;
+
+  void load();
+
+  // Must be called with the mutex locked
+  void save() const;
+};
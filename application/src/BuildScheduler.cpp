@@ -0,0 +1,413 @@
+#include "pch.h"
+
+#include "BuildScheduler.h"
+
+static auto
+make_sweep(const geodata::BuilderSettings &settings,
+           const std::vector<BuildConfig::SweepSettings> &sweep_settings)
+    -> std::vector<geodata::BuilderSettings> {
+
+  std::vector<geodata::BuilderSettings> sweep;
+
+  for (const auto &overrides : sweep_settings) {
+    auto swept = settings;
+    swept.actor_height = overrides.actor_height;
+    swept.actor_radius = overrides.actor_radius;
+    swept.min_walkable_climb = overrides.min_walkable_climb;
+    swept.max_walkable_climb = overrides.max_walkable_climb;
+    sweep.push_back(swept);
+  }
+
+  return sweep;
+}
+
+static auto
+make_sweep_exporters(const std::vector<geodata::BuilderSettings> &sweep)
+    -> std::vector<geodata::Exporter> {
+
+  std::vector<geodata::Exporter> exporters;
+
+  for (const auto &settings : sweep) {
+    std::ostringstream name;
+    name << "sweep_" << settings.actor_height << "_" << settings.actor_radius
+         << "_" << settings.min_walkable_climb << "_"
+         << settings.max_walkable_climb;
+
+    const auto path = std::filesystem::path{"output"} / name.str();
+    std::filesystem::create_directories(path);
+    exporters.emplace_back(path);
+  }
+
+  return exporters;
+}
+
+BuildScheduler::BuildScheduler(const UnrealLoader &unreal_loader,
+                               const geodata::BuilderSettings &settings,
+                               const unreal::CacheConfig &cache_config,
+                               const BuildConfig &build_config)
+    : m_unreal_loader{unreal_loader}, m_settings{settings},
+      m_cache_config{cache_config}, m_exporter{"output"},
+      m_manifest{"output/build.manifest", unreal_loader, settings},
+      m_force{build_config.force},
+      m_map_cache{build_config.map_cache.empty()
+                      ? nullptr
+                      : std::make_unique<geodata::MapCache>(
+                            build_config.map_cache)},
+      m_transform_pool{std::max(std::thread::hardware_concurrency(), 1u)},
+      m_sweep{make_sweep(settings, build_config.sweep)},
+      m_sweep_exporters{make_sweep_exporters(m_sweep)},
+      m_jobs{std::max<std::size_t>(build_config.jobs, 1)},
+      m_builder_count{m_jobs + 1}, m_memory_limit{0}, m_reserved_memory{0},
+      m_allocated_builders{0}, m_free_builders{} {
+
+  if (build_config.memory_limit == 0) {
+    return;
+  }
+
+  const auto buffer_size = geodata::ExportBuffer::memory_size();
+  const auto max_builders =
+      std::max<std::size_t>(build_config.memory_limit / buffer_size, 1);
+
+  if (m_builder_count > max_builders) {
+    m_builder_count = max_builders;
+
+    // Prefer overlapping export with a single job to an extra job
+    m_jobs = std::max<std::size_t>(max_builders - 1, 1);
+
+    utils::Log(utils::LOG_WARN, "App")
+        << "Only " << max_builders
+        << " export buffers fit in the memory limit, using " << m_jobs
+        << " jobs" << std::endl;
+  }
+
+  // Export buffers are allocated once per builder, maps share the rest
+  const auto buffers_size = m_builder_count * buffer_size;
+  m_memory_limit = build_config.memory_limit > buffers_size
+                       ? build_config.memory_limit - buffers_size
+                       : 1;
+}
+
+void BuildScheduler::build(const std::vector<std::string> &map_names) const {
+  utils::Log(utils::LOG_INFO, "App")
+      << "Building " << map_names.size() << " maps in " << m_jobs << " jobs"
+      << std::endl;
+
+  utils::BoundedQueue<LoadedMap> loaded_maps{m_jobs};
+  utils::BoundedQueue<BuiltMap> built_maps{m_builder_count};
+
+  // Loading, jobs and export
+  utils::ThreadPool thread_pool{m_jobs + 2};
+  std::vector<std::future<void>> stages;
+
+  stages.push_back(
+      thread_pool.submit([this, &map_names, &loaded_maps, &built_maps] {
+        load_maps(map_names, loaded_maps, built_maps);
+      }));
+
+  std::vector<std::future<void>> jobs;
+
+  for (std::size_t i = 0; i < m_jobs; ++i) {
+    jobs.push_back(thread_pool.submit([this, &loaded_maps, &built_maps] {
+      build_maps(loaded_maps, built_maps);
+    }));
+  }
+
+  stages.push_back(thread_pool.submit([this, &loaded_maps, &built_maps] {
+    export_maps(loaded_maps, built_maps);
+  }));
+
+  // Failed stage cancels the others, all of them are waited for before the
+  // first error is rethrown
+  std::exception_ptr error;
+
+  const auto wait = [&error](std::future<void> &stage) {
+    try {
+      stage.get();
+    } catch (...) {
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+    }
+  };
+
+  for (auto &job : jobs) {
+    wait(job);
+  }
+
+  built_maps.close();
+
+  for (auto &stage : stages) {
+    wait(stage);
+  }
+
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+void BuildScheduler::cancel(utils::BoundedQueue<LoadedMap> &loaded_maps,
+                            utils::BoundedQueue<BuiltMap> &built_maps) const {
+
+  loaded_maps.close();
+  built_maps.close();
+
+  while (loaded_maps.pop()) {
+  }
+
+  // Jobs may wait for these builders
+  while (auto built_map = built_maps.pop()) {
+    release_builder(std::move(built_map->builder));
+  }
+}
+
+void BuildScheduler::load_maps(
+    const std::vector<std::string> &map_names,
+    utils::BoundedQueue<LoadedMap> &loaded_maps,
+    utils::BoundedQueue<BuiltMap> &built_maps) const {
+
+  try {
+    for (const auto &map_name : map_names) {
+      if (!m_force && m_sweep.empty() &&
+          m_manifest.is_up_to_date(map_name, m_exporter.l2j_path(map_name))) {
+
+        utils::Log(utils::LOG_INFO, "App")
+            << "Map is up to date: " << map_name << std::endl;
+        continue;
+      }
+
+      auto loaded_map = load_map(map_name);
+
+      // Closed if another stage failed
+      if (loaded_map.has_value() &&
+          !loaded_maps.push(std::move(*loaded_map))) {
+
+        break;
+      }
+    }
+  } catch (...) {
+    cancel(loaded_maps, built_maps);
+    throw;
+  }
+
+  loaded_maps.close();
+}
+
+auto BuildScheduler::load_map(const std::string &map_name) const
+    -> std::optional<LoadedMap> {
+
+  const auto start_time = Clock::now();
+
+  // Cached map is only fresh if the packages it was loaded from didn't change
+  if (m_map_cache != nullptr && !m_force) {
+    const auto is_fresh = [this](const geodata::MapCache::Sources &sources) {
+      return m_manifest.has_unchanged_sources(sources);
+    };
+
+    if (auto entry = m_map_cache->load(map_name, is_fresh)) {
+      utils::Log(utils::LOG_INFO, "App")
+          << "Map loaded from cache: " << map_name << std::endl;
+
+      std::vector<std::string> packages;
+
+      for (const auto &file : entry->sources.files) {
+        packages.push_back(file.name);
+      }
+
+      return LoadedMap{map_name, std::move(packages), std::move(entry->map),
+                       start_time};
+    }
+  }
+
+  utils::Log(utils::LOG_INFO, "App")
+      << "Loading map: " << map_name << std::endl;
+
+  std::vector<std::string> packages;
+  auto geodata_map = m_unreal_loader.load_geodata_map(map_name, packages,
+                                                      &m_transform_pool);
+
+  if (m_cache_config.memory_budget > 0) {
+    m_unreal_loader.evict_unused_meshes(m_cache_config.memory_budget);
+  }
+
+  if (!geodata_map) {
+    return {};
+  }
+
+  if (m_map_cache != nullptr) {
+    m_map_cache->store(*geodata_map, m_manifest.sources(packages));
+  }
+
+  return LoadedMap{map_name, std::move(packages), std::move(*geodata_map),
+                   start_time};
+}
+
+void BuildScheduler::build_maps(
+    utils::BoundedQueue<LoadedMap> &loaded_maps,
+    utils::BoundedQueue<BuiltMap> &built_maps) const {
+
+  // Released if building fails, so other jobs don't wait for them forever
+  std::size_t reserved_memory = 0;
+  std::unique_ptr<geodata::Builder> builder;
+
+  try {
+    while (auto loaded_map = loaded_maps.pop()) {
+      const auto memory_usage =
+          geodata::Builder::estimate_memory_usage(loaded_map->map, m_settings);
+
+      reserve_memory(memory_usage);
+      reserved_memory = memory_usage;
+      builder = acquire_builder();
+
+      if (!m_sweep.empty()) {
+        build_sweep(*loaded_map, *builder);
+        release_memory(std::exchange(reserved_memory, 0));
+        release_builder(std::move(builder));
+        continue;
+      }
+
+      utils::Log(utils::LOG_INFO, "App")
+          << "Building geodata for map: " << loaded_map->name << std::endl;
+
+      const auto &buffer = builder->build(loaded_map->map, m_settings);
+
+      release_memory(std::exchange(reserved_memory, 0));
+
+      BuiltMap built_map{loaded_map->name, std::move(loaded_map->packages),
+                         std::move(builder), &buffer,
+                         loaded_map->start_time};
+
+      // Closed if export failed
+      if (!built_maps.push(std::move(built_map))) {
+        release_builder(std::move(built_map.builder));
+      }
+    }
+  } catch (...) {
+    release_memory(reserved_memory);
+
+    if (builder != nullptr) {
+      release_builder(std::move(builder));
+    }
+
+    cancel(loaded_maps, built_maps);
+    throw;
+  }
+}
+
+void BuildScheduler::export_maps(
+    utils::BoundedQueue<LoadedMap> &loaded_maps,
+    utils::BoundedQueue<BuiltMap> &built_maps) const {
+
+  while (auto built_map = built_maps.pop()) {
+    utils::Log(utils::LOG_INFO, "App")
+        << "Exporting geodata for map: " << built_map->name << std::endl;
+
+    try {
+      m_exporter.export_l2j_geodata(*built_map->buffer, built_map->name);
+      release_builder(std::move(built_map->builder));
+      m_manifest.update(built_map->name, built_map->packages);
+    } catch (...) {
+      if (built_map->builder != nullptr) {
+        release_builder(std::move(built_map->builder));
+      }
+
+      cancel(loaded_maps, built_maps);
+      throw;
+    }
+
+    const auto build_time =
+        std::chrono::duration<float>(Clock::now() - built_map->start_time);
+
+    // Maps are built concurrently, so only the process peak is measured
+    utils::Log(utils::LOG_INFO, "App")
+        << "Map " << built_map->name << " built in " << build_time.count()
+        << " s, process peak memory "
+        << utils::peak_resident_memory() / (1024 * 1024) << " MB"
+        << std::endl;
+  }
+}
+
+void BuildScheduler::build_sweep(const LoadedMap &loaded_map,
+                                 const geodata::Builder &builder) const {
+
+  utils::Log(utils::LOG_INFO, "App")
+      << "Building geodata for map: " << loaded_map.name << " with "
+      << m_sweep.size() << " settings" << std::endl;
+
+  builder.build(loaded_map.map, m_sweep,
+                [this, &loaded_map](std::size_t index,
+                                    const geodata::ExportBuffer &buffer) {
+                  m_sweep_exporters[index].export_l2j_geodata(buffer,
+                                                              loaded_map.name);
+                });
+
+  const auto build_time =
+      std::chrono::duration<float>(Clock::now() - loaded_map.start_time);
+
+  utils::Log(utils::LOG_INFO, "App")
+      << "Map " << loaded_map.name << " built with " << m_sweep.size()
+      << " settings in " << build_time.count() << " s, process peak memory "
+      << utils::peak_resident_memory() / (1024 * 1024) << " MB"
+      << std::endl;
+}
+
+void BuildScheduler::reserve_memory(std::size_t size) const {
+  if (m_memory_limit == 0) {
+    return;
+  }
+
+  std::unique_lock lock{m_mutex};
+
+  m_memory_released.wait(lock, [this, size] {
+    return m_reserved_memory == 0 || m_reserved_memory + size <= m_memory_limit;
+  });
+
+  m_reserved_memory += size;
+}
+
+void BuildScheduler::release_memory(std::size_t size) const {
+  if (m_memory_limit == 0) {
+    return;
+  }
+
+  {
+    const std::lock_guard lock{m_mutex};
+    m_reserved_memory -= size;
+  }
+
+  m_memory_released.notify_all();
+}
+
+auto BuildScheduler::acquire_builder() const
+    -> std::unique_ptr<geodata::Builder> {
+
+  {
+    std::unique_lock lock{m_mutex};
+
+    m_builder_released.wait(lock, [this] {
+      return !m_free_builders.empty() ||
+             m_allocated_builders < m_builder_count;
+    });
+
+    if (!m_free_builders.empty()) {
+      auto builder = std::move(m_free_builders.back());
+      m_free_builders.pop_back();
+      return builder;
+    }
+
+    ++m_allocated_builders;
+  }
+
+  // Builders are allocated on demand
+  return std::make_unique<geodata::Builder>();
+}
+
+void BuildScheduler::release_builder(
+    std::unique_ptr<geodata::Builder> builder) const {
+
+  {
+    const std::lock_guard lock{m_mutex};
+    m_free_builders.push_back(std::move(builder));
+  }
+
+  m_builder_released.notify_one();
+}
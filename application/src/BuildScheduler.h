@@ -0,0 +1,124 @@
+#pragma once
+
+#include "BuildConfig.h"
+#include "BuildManifest.h"
+#include "UnrealLoader.h"
+
+#include <utils/BoundedQueue.h>
+#include <utils/ThreadPool.h>
+
+#include <geodata/Builder.h>
+#include <geodata/BuilderSettings.h>
+#include <geodata/ExportBuffer.h>
+#include <geodata/Exporter.h>
+#include <geodata/Map.h>
+#include <geodata/MapCache.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Builds maps in a pipeline: maps are loaded on one thread, built by several
+// jobs and exported on another thread, so loading of the next map and export
+// of the previous one overlap with building.
+//
+// Every job needs its own geodata builder with a ~1 GiB export buffer, one
+// more builder lets export overlap with building. Builders are recycled after
+// export. The number of builders is capped by the memory limit, the rest of
+// the limit is shared by jobs according to their estimated memory usage.
+//
+// Maps whose inputs didn't change since the last build are skipped, unless
+// the build is forced.
+//
+// In sweep mode every map is rasterized once and built with each of the swept
+// settings, results go to a separate directory per settings. Sweep builds
+// aren't recorded in the build manifest.
+class BuildScheduler {
+public:
+  explicit BuildScheduler(const UnrealLoader &unreal_loader,
+                          const geodata::BuilderSettings &settings,
+                          const unreal::CacheConfig &cache_config,
+                          const BuildConfig &build_config);
+
+  void build(const std::vector<std::string> &map_names) const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct LoadedMap {
+    std::string name;
+    std::vector<std::string> packages;
+    geodata::Map map;
+    Clock::time_point start_time;
+  };
+
+  struct BuiltMap {
+    std::string name;
+    std::vector<std::string> packages;
+    std::unique_ptr<geodata::Builder> builder;
+    const geodata::ExportBuffer *buffer;
+    Clock::time_point start_time;
+  };
+
+  const UnrealLoader &m_unreal_loader;
+  const geodata::BuilderSettings m_settings;
+  const unreal::CacheConfig m_cache_config;
+  const geodata::Exporter m_exporter;
+  const BuildManifest m_manifest;
+  const bool m_force;
+  const std::unique_ptr<geodata::MapCache> m_map_cache;
+
+  // Transforms entities of loaded maps, pipeline threads can't be used as
+  // they may wait for the loader
+  mutable utils::ThreadPool m_transform_pool;
+
+  const std::vector<geodata::BuilderSettings> m_sweep;
+  const std::vector<geodata::Exporter> m_sweep_exporters;
+
+  std::size_t m_jobs;
+  std::size_t m_builder_count;
+  std::size_t m_memory_limit;
+
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_memory_released;
+  mutable std::condition_variable m_builder_released;
+  mutable std::size_t m_reserved_memory;
+  mutable std::size_t m_allocated_builders;
+  mutable std::vector<std::unique_ptr<geodata::Builder>> m_free_builders;
+
+  // Pipeline stages, a failed stage cancels the whole pipeline and its
+  // exception is rethrown from build
+  void load_maps(const std::vector<std::string> &map_names,
+                 utils::BoundedQueue<LoadedMap> &loaded_maps,
+                 utils::BoundedQueue<BuiltMap> &built_maps) const;
+  void build_maps(utils::BoundedQueue<LoadedMap> &loaded_maps,
+                  utils::BoundedQueue<BuiltMap> &built_maps) const;
+  void export_maps(utils::BoundedQueue<LoadedMap> &loaded_maps,
+                   utils::BoundedQueue<BuiltMap> &built_maps) const;
+
+  // Closes both queues and drops queued maps, so other stages stop instead
+  // of waiting for a failed one
+  void cancel(utils::BoundedQueue<LoadedMap> &loaded_maps,
+              utils::BoundedQueue<BuiltMap> &built_maps) const;
+
+  // Builds and exports the map with every swept settings
+  void build_sweep(const LoadedMap &loaded_map,
+                   const geodata::Builder &builder) const;
+
+  // Loads the map from the map cache if it's fresh or from the client
+  auto load_map(const std::string &map_name) const -> std::optional<LoadedMap>;
+
+  // Waits until the memory fits in the limit, a single job is always allowed
+  // to run
+  void reserve_memory(std::size_t size) const;
+  void release_memory(std::size_t size) const;
+
+  // Waits until a builder is exported if all of them are in use
+  auto acquire_builder() const -> std::unique_ptr<geodata::Builder>;
+  void release_builder(std::unique_ptr<geodata::Builder> builder) const;
+};
@@ -20,6 +20,10 @@ enum SurfaceType {
   SURFACE_BOUNDING_BOX = 0x10,
   SURFACE_IMPORTED_GEODATA = 0x20,
   SURFACE_GENERATED_GEODATA = 0x40,
+
+  // Simplified collision geometry, replaces other surfaces of the mesh in
+  // geodata and isn't rendered
+  SURFACE_COLLISION = 0x80,
 };
 
 enum TextureFormat {
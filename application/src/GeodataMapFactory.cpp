@@ -0,0 +1,128 @@
+#include "pch.h"
+
+#include "GeodataMapFactory.h"
+
+auto GeodataMapFactory::make_map(const Map &map,
+                                 utils::ThreadPool *thread_pool) const
+    -> std::optional<geodata::Map> {
+
+  if (map.entities.empty()) {
+    return {};
+  }
+
+  geodata::Map geodata_map{map.name, map.bounding_box};
+
+  if (map.terrain.has_value()) {
+    geodata_map.add(*map.terrain);
+  }
+
+  std::vector<geodata::Entity> geodata_entities;
+
+  for (const auto &entity : map.entities) {
+    std::unique_lock lock{m_mutex};
+
+    auto cached_mesh = m_mesh_cache.find(entity.mesh.get());
+
+    if (cached_mesh != m_mesh_cache.end() &&
+        cached_mesh->second.source.lock() == entity.mesh) {
+
+      ++m_reused_meshes;
+    } else {
+      cached_mesh = m_mesh_cache
+                        .insert_or_assign(entity.mesh.get(),
+                                          CachedMesh{entity.mesh,
+                                                     convert_mesh(entity)})
+                        .first;
+    }
+
+    const auto mesh = cached_mesh->second.mesh;
+    lock.unlock();
+
+    if (mesh == nullptr) {
+      continue;
+    }
+
+    geodata_entities.push_back({mesh, entity.model_matrix()});
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+  geodata_map.add(geodata_entities, thread_pool);
+  const auto transform_time = std::chrono::steady_clock::now() - start_time;
+
+  utils::Log(utils::LOG_INFO, "App")
+      << "Geodata map " << map.name << ": "
+      << geodata_map.vertices().size() << " vertices, "
+      << geodata_map.indices().size() / 3 << " triangles, "
+      << geodata_map.instances().size() << " mesh instances, transformed in "
+      << std::chrono::duration<float>(transform_time).count() << " s"
+      << std::endl;
+
+  return geodata_map;
+}
+
+void GeodataMapFactory::evict_unused_meshes() const {
+  const std::lock_guard lock{m_mutex};
+
+  std::erase_if(m_mesh_cache, [](const auto &pair) {
+    return pair.second.source.expired();
+  });
+}
+
+auto GeodataMapFactory::reused_meshes() const -> std::size_t {
+  const std::lock_guard lock{m_mutex};
+  return m_reused_meshes;
+}
+
+auto GeodataMapFactory::convert_mesh(const Entity<EntityMesh> &entity) const
+    -> std::shared_ptr<geodata::Mesh> {
+
+  std::vector<geodata::Vertex> vertices;
+  std::vector<unsigned int> indices;
+
+  // Mesh stays indexed, only vertices of the remaining surfaces are kept
+  static constexpr auto no_vertex = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> vertex_map(entity.mesh->vertices.size(),
+                                       no_vertex);
+
+  // Collision surface replaces render surfaces of the mesh
+  const auto has_collision_surface =
+      std::any_of(entity.mesh->surfaces.begin(), entity.mesh->surfaces.end(),
+                  [](const Surface &surface) {
+                    return (surface.type & SURFACE_COLLISION) != 0;
+                  });
+
+  for (const auto &surface : entity.mesh->surfaces) {
+    // Terrain is added as a heightmap
+    if ((surface.type &
+         (SURFACE_PASSABLE | SURFACE_BOUNDING_BOX | SURFACE_TERRAIN)) != 0 ||
+        (has_collision_surface && (surface.type & SURFACE_COLLISION) == 0)) {
+
+      continue;
+    }
+
+    for (auto i = surface.index_offset;
+         i < (surface.index_offset + surface.index_count); ++i) {
+
+      const auto index = entity.mesh->indices[i];
+
+      if (vertex_map[index] == no_vertex) {
+        vertex_map[index] = vertices.size();
+        vertices.push_back({entity.mesh->vertices[index].position,
+                            entity.mesh->vertices[index].normal});
+      }
+
+      indices.push_back(vertex_map[index]);
+    }
+  }
+
+  if (vertices.empty() || indices.empty()) {
+    return nullptr;
+  }
+
+  const auto mesh = std::make_shared<geodata::Mesh>();
+  mesh->vertices.swap(vertices);
+  mesh->indices.swap(indices);
+  mesh->instance_matrices = entity.instance_matrices();
+
+  return mesh;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Entity.h"
+#include "Map.h"
+
+#include <geodata/Entity.h>
+#include <geodata/Map.h>
+
+#include <utils/ThreadPool.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+// Converts loaded maps to geodata maps. Converted meshes are cached by
+// source mesh, so meshes shared by several maps are converted once. Maps can
+// be made concurrently.
+class GeodataMapFactory {
+public:
+  explicit GeodataMapFactory() : m_reused_meshes{0} {}
+
+  // Returns nothing for maps without entities, entities are transformed on
+  // the thread pool
+  auto make_map(const Map &map, utils::ThreadPool *thread_pool) const
+      -> std::optional<geodata::Map>;
+
+  // Drops conversions of meshes which are no longer alive
+  void evict_unused_meshes() const;
+
+  auto reused_meshes() const -> std::size_t;
+
+private:
+  struct CachedMesh {
+    std::weak_ptr<EntityMesh> source;
+    std::shared_ptr<geodata::Mesh> mesh;
+  };
+
+  // Keyed by source mesh address, the weak pointer guards against addresses
+  // reused after the source mesh was freed
+  mutable std::mutex m_mutex;
+  mutable std::unordered_map<const EntityMesh *, CachedMesh> m_mesh_cache;
+  mutable std::size_t m_reused_meshes;
+
+  auto convert_mesh(const Entity<EntityMesh> &entity) const
+      -> std::shared_ptr<geodata::Mesh>;
+};
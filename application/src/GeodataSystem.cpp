@@ -13,15 +13,7 @@ GeodataSystem::GeodataSystem(GeodataContext &geodata_context,
 }
 
 void GeodataSystem::build() const {
-  geodata::BuilderSettings settings{
-      m_ui_context.geodata.actor_height,
-      m_ui_context.geodata.actor_radius,
-      m_ui_context.geodata.max_walkable_angle,
-      m_ui_context.geodata.min_walkable_climb,
-      m_ui_context.geodata.max_walkable_climb,
-      m_ui_context.geodata.cell_size,
-      m_ui_context.geodata.cell_height,
-  };
+  const auto settings = m_ui_context.geodata.builder_settings();
 
   geodata::Builder geodata_builder;
   geodata::Exporter geodata_exporter{"output"};
@@ -1,16 +1,15 @@
 #include "pch.h"
 
 #include "GeodataEntityFactory.h"
+#include "GeodataMapFactory.h"
 #include "LoadingSystem.h"
-#include "UnrealLoader.h"
 
 LoadingSystem::LoadingSystem(GeodataContext &geodata_context,
                              const Renderer *renderer,
-                             const std::filesystem::path &root_path,
+                             const UnrealLoader &unreal_loader,
                              const std::vector<std::string> &map_names)
     : m_geodata_context{geodata_context}, m_renderer{renderer} {
 
-  UnrealLoader unreal_loader{root_path};
   geodata::Loader geodata_loader{"geodata"};
 
   GeodataEntityFactory geodata_entity_factory;
@@ -58,69 +57,13 @@ LoadingSystem::LoadingSystem(GeodataContext &geodata_context,
 }
 
 void LoadingSystem::prebuild_maps(const std::vector<Map> &maps) const {
-  std::unordered_map<std::shared_ptr<EntityMesh>,
-                     std::shared_ptr<geodata::Mesh>>
-      entity_mesh_cache;
+  GeodataMapFactory geodata_map_factory;
+  utils::ThreadPool thread_pool{
+      std::max(std::thread::hardware_concurrency(), 1u)};
 
   for (const auto &map : maps) {
-    if (map.entities.empty()) {
-      continue;
+    if (auto geodata_map = geodata_map_factory.make_map(map, &thread_pool)) {
+      m_geodata_context.maps.push_back(std::move(*geodata_map));
     }
-
-    geodata::Map geodata_map{map.name, map.bounding_box};
-
-    for (const auto &entity : map.entities) {
-      // Load mesh if needed
-      auto cached_mesh = entity_mesh_cache.find(entity.mesh);
-
-      if (cached_mesh == entity_mesh_cache.end()) {
-        std::vector<geodata::Vertex> vertices;
-        std::vector<unsigned int> indices;
-        auto skipped_indices = 0;
-
-        for (const auto &surface : entity.mesh->surfaces) {
-          if ((surface.type & (SURFACE_PASSABLE | SURFACE_BOUNDING_BOX)) != 0) {
-            skipped_indices += surface.index_count;
-            continue;
-          }
-
-          for (auto i = surface.index_offset;
-               i < (surface.index_offset + surface.index_count); ++i) {
-
-            const auto index = entity.mesh->indices[i];
-
-            vertices.push_back({entity.mesh->vertices[index].position,
-                                entity.mesh->vertices[index].normal});
-
-            indices.push_back(i - skipped_indices);
-          }
-        }
-
-        if (vertices.empty() || indices.empty()) {
-          entity_mesh_cache.insert({entity.mesh, nullptr});
-          continue;
-        }
-
-        const auto mesh = std::make_shared<geodata::Mesh>();
-        mesh->vertices.swap(vertices);
-        mesh->indices.swap(indices);
-        mesh->instance_matrices = entity.instance_matrices();
-
-        cached_mesh = entity_mesh_cache.insert({entity.mesh, mesh}).first;
-      }
-
-      if (cached_mesh->second == nullptr) {
-        continue;
-      }
-
-      geodata::Entity geodata_entity{
-          cached_mesh->second,
-          entity.model_matrix(),
-      };
-
-      geodata_map.add(geodata_entity);
-    }
-
-    m_geodata_context.maps.push_back(std::move(geodata_map));
   }
 }
@@ -4,8 +4,8 @@
 #include "Map.h"
 #include "Renderer.h"
 #include "System.h"
+#include "UnrealLoader.h"
 
-#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -13,7 +13,7 @@ class LoadingSystem : public System {
 public:
   explicit LoadingSystem(GeodataContext &geodata_context,
                          const Renderer *renderer,
-                         const std::filesystem::path &root_path,
+                         const UnrealLoader &unreal_loader,
                          const std::vector<std::string> &map_names);
 
 private:
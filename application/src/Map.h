@@ -2,10 +2,13 @@
 
 #include "Entity.h"
 
+#include <geodata/Terrain.h>
+
 #include <geometry/Box.h>
 
 #include <glm/glm.hpp>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -15,5 +18,13 @@ struct Map {
   glm::vec3 position;
   geometry::Box bounding_box;
 
-  explicit Map() : name{}, entities{}, position{}, bounding_box{} {}
+  // Terrain heightmap for geodata, terrain entities are only rendered
+  std::optional<geodata::Terrain> terrain;
+
+  // Lowercase names of client packages used to load the map
+  std::vector<std::string> packages;
+
+  explicit Map()
+      : name{}, entities{}, position{}, bounding_box{}, terrain{},
+        packages{} {}
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <geodata/BuilderSettings.h>
+
 #include <functional>
 
 struct UIContext {
@@ -46,5 +48,13 @@ struct UIContext {
       cell_size = 16.0f;
       cell_height = 1.0f;
     }
+
+    auto builder_settings() const -> geodata::BuilderSettings {
+      return geodata::BuilderSettings{
+          actor_height,       actor_radius,       max_walkable_angle,
+          min_walkable_climb, max_walkable_climb, cell_size,
+          cell_height,
+      };
+    }
   } geodata;
 };
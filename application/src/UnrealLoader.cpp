@@ -3,14 +3,26 @@
 #include "UnrealConverters.h"
 #include "UnrealLoader.h"
 
-UnrealLoader::UnrealLoader(const std::filesystem::path &root_path)
+UnrealLoader::UnrealLoader(const std::filesystem::path &root_path,
+                           const unreal::CacheConfig &cache_config,
+                           bool simple_collision)
     : m_package_loader{root_path,
                        {unreal::SearchConfig{"Maps", "unr"},
                         unreal::SearchConfig{"StaticMeshes", "usx"},
                         unreal::SearchConfig{"Textures", "utx"},
-                        unreal::SearchConfig{"SysTextures", "utx"}}} {}
+                        unreal::SearchConfig{"SysTextures", "utx"}},
+                       cache_config},
+      m_simple_collision{simple_collision}, m_mesh_statistics{},
+      m_map_counter{0} {}
 
 auto UnrealLoader::load_map(const std::string &name) const -> Map {
+  {
+    const std::lock_guard lock{m_mesh_mutex};
+    ++m_map_counter;
+  }
+
+  const unreal::PackageRecorder package_recorder;
+
   Map map{};
 
   const auto optional_package = m_package_loader.load_package(name);
@@ -36,6 +48,7 @@ auto UnrealLoader::load_map(const std::string &name) const -> Map {
     map.entities.insert(map.entities.end(),
                         std::make_move_iterator(terrain_entities.begin()),
                         std::make_move_iterator(terrain_entities.end()));
+    map.terrain = load_geodata_terrain(*terrain);
   }
 #endif
 
@@ -57,18 +70,115 @@ auto UnrealLoader::load_map(const std::string &name) const -> Map {
                       std::make_move_iterator(volume_entities.begin()),
                       std::make_move_iterator(volume_entities.end()));
 
+  map.packages.assign(package_recorder.packages().begin(),
+                      package_recorder.packages().end());
+  std::sort(map.packages.begin(), map.packages.end());
+
   return map;
 }
 
-auto UnrealLoader::load_map_package(int x, int y) const
-    -> std::optional<unreal::Package> {
+auto UnrealLoader::load_geodata_map(const std::string &name,
+                                    std::vector<std::string> &packages,
+                                    utils::ThreadPool *thread_pool) const
+    -> std::optional<geodata::Map> {
 
-  std::stringstream stream;
-  stream << x << "_" << y;
-  const auto package_name = stream.str();
+  {
+    const std::lock_guard lock{m_mesh_mutex};
+    ++m_map_counter;
+  }
+
+  const unreal::PackageRecorder package_recorder;
+
+  // Only static meshes are read in build mode, textures aren't prefetched
+  const auto optional_package =
+      m_package_loader.load_package(name, true, {"usx"});
+
+  if (!optional_package.has_value()) {
+    return {};
+  }
+
+  const auto package = optional_package.value();
 
-  const auto package = m_package_loader.load_package(package_name);
-  return package;
+  // Terrain
+  const auto terrain = load_terrain(package);
+
+  const auto position = to_vec3(terrain->position());
+  const auto scale = to_vec3(terrain->scale());
+  const geometry::Box bounding_box{
+      to_vec3(terrain->bounding_box().min) * scale + position,
+      to_vec3(terrain->bounding_box().max) * scale + position};
+
+  geodata::Map map{name, bounding_box};
+
+#ifdef LOAD_TERRAIN
+  if (!terrain->broken_scale()) {
+    map.add(load_geodata_terrain(*terrain));
+  }
+#endif
+
+  // Same order as entities of the loaded map, so geodata is the same
+  std::vector<geodata::Entity> entities;
+  load_geodata_mesh_actors(package, entities);
+  load_geodata_bsps(package, bounding_box, entities);
+  load_geodata_volumes(package, bounding_box, entities);
+
+  map.add(entities, thread_pool);
+
+  packages.assign(package_recorder.packages().begin(),
+                  package_recorder.packages().end());
+  std::sort(packages.begin(), packages.end());
+
+  return map;
+}
+
+void UnrealLoader::evict_unused_meshes(std::size_t memory_budget) const {
+  const std::lock_guard lock{m_mesh_mutex};
+
+  if (m_mesh_statistics.resident_bytes <= memory_budget) {
+    return;
+  }
+
+  std::vector<std::unordered_map<std::string, CachedMesh>::iterator>
+      candidates;
+
+  for (auto it = m_mesh_cache.begin(); it != m_mesh_cache.end(); ++it) {
+    if (it->second.mesh.use_count() <= 1 &&
+        it->second.bb_mesh.use_count() <= 1 &&
+        it->second.geodata_mesh.use_count() <= 1) {
+
+      candidates.push_back(it);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &a, const auto &b) {
+              return a->second.last_used < b->second.last_used;
+            });
+
+  for (const auto &candidate : candidates) {
+    if (m_mesh_statistics.resident_bytes <= memory_budget) {
+      break;
+    }
+
+    m_mesh_statistics.resident_bytes -= candidate->second.size;
+    ++m_mesh_statistics.evictions;
+    m_mesh_cache.erase(candidate);
+  }
+}
+
+auto UnrealLoader::find_package(const std::string &name) const
+    -> const unreal::PackageFile * {
+
+  return m_package_loader.find_package(name);
+}
+
+auto UnrealLoader::package_statistics() const -> unreal::CacheStatistics {
+  return m_package_loader.cache_statistics();
+}
+
+auto UnrealLoader::mesh_statistics() const -> unreal::CacheStatistics {
+  const std::lock_guard lock{m_mesh_mutex};
+  return m_mesh_statistics;
 }
 
 auto UnrealLoader::load_terrain(const unreal::Package &package) const
@@ -89,21 +199,66 @@ auto UnrealLoader::load_terrain(const unreal::Package &package) const
 }
 
 auto UnrealLoader::load_side_terrain(int x, int y) const
-    -> std::shared_ptr<unreal::TerrainInfoActor> {
+    -> std::shared_ptr<const SideTerrain> {
+
+  std::stringstream stream;
+  stream << x << "_" << y;
+  const auto package_name = stream.str();
+
+  std::promise<std::shared_ptr<const SideTerrain>> promise;
+
+  {
+    const std::lock_guard lock{m_side_terrain_mutex};
+    const auto pair = m_side_terrains.find(package_name);
+
+    if (pair != m_side_terrains.end()) {
+      const auto side_terrain = pair->second;
+
+      // Package is still an input of the map even if it's not read again
+      unreal::PackageRecorder::record(package_name);
+      return side_terrain.get();
+    }
+
+    m_side_terrains.emplace(package_name, promise.get_future().share());
+  }
 
-  const auto package = load_map_package(x, y);
+  const auto side_terrain = read_side_terrain(package_name);
+  promise.set_value(side_terrain);
+  return side_terrain;
+}
+
+auto UnrealLoader::read_side_terrain(const std::string &package_name) const
+    -> std::shared_ptr<const SideTerrain> {
+
+  // Only the terrain and its heightmap are read, so imports aren't prefetched
+  const auto package = m_package_loader.load_package(package_name, false);
 
   if (!package.has_value()) {
     return nullptr;
   }
 
-  auto terrain = load_terrain(package.value());
+  const auto terrain = load_terrain(package.value());
 
   if (terrain->broken_scale()) {
     return nullptr;
   }
 
-  return terrain;
+  const auto &mip = terrain->terrain_map->mips[0];
+  const auto *heightmap = mip.as<std::uint16_t>();
+
+  const auto width = terrain->terrain_map->u_size;
+  const auto height = terrain->terrain_map->v_size;
+
+  auto side_terrain = std::make_shared<SideTerrain>();
+  side_terrain->position_z = terrain->position().z;
+  side_terrain->scale_z = terrain->scale().z;
+  side_terrain->first_row.assign(heightmap, heightmap + width);
+
+  for (auto y = 0; y < height; ++y) {
+    side_terrain->first_column.push_back(heightmap[y * width]);
+  }
+
+  return side_terrain;
 }
 
 auto UnrealLoader::load_terrain_entities(
@@ -189,14 +344,13 @@ auto UnrealLoader::load_terrain_entities(
   {
     if (south_terrain != nullptr) {
       const glm::vec3 position = {terrain.position().x, terrain.position().y,
-                                  south_terrain->position().z};
+                                  south_terrain->position_z};
       const glm::vec3 scale = {terrain.scale().x, terrain.scale().y,
-                               south_terrain->scale().z};
+                               south_terrain->scale_z};
 
       const auto y = height;
 
-      const auto *heightmap =
-          south_terrain->terrain_map->mips[0].as<std::uint16_t>();
+      const auto &heightmap = south_terrain->first_row;
 
       for (auto x = 0; x < width; ++x) {
         mesh->vertices.push_back(
@@ -229,22 +383,21 @@ auto UnrealLoader::load_terrain_entities(
   {
     if (east_terrain != nullptr) {
       const glm::vec3 position = {terrain.position().x, terrain.position().y,
-                                  east_terrain->position().z};
+                                  east_terrain->position_z};
       const glm::vec3 scale = {terrain.scale().x, terrain.scale().y,
-                               east_terrain->scale().z};
+                               east_terrain->scale_z};
 
       const auto x = width;
 
-      const auto *heightmap =
-          east_terrain->terrain_map->mips[0].as<std::uint16_t>();
+      const auto &heightmap = east_terrain->first_column;
 
       for (auto y = 0; y < height; ++y) {
         mesh->vertices.push_back(
-            {glm::vec3{x, y, heightmap[y * width]} * scale + position,
+            {glm::vec3{x, y, heightmap[y]} * scale + position,
              {0.0f, 0.0f, 0.0f},
              {0.0f, 0.0f}});
 
-        heights[y * full_width + x] = heightmap[y * width];
+        heights[y * full_width + x] = heightmap[y];
 
         // First part of quad
         if (y != height - 1) {
@@ -270,15 +423,14 @@ auto UnrealLoader::load_terrain_entities(
   {
     if (southeast_terrain != nullptr) {
       const glm::vec3 position = {terrain.position().x, terrain.position().y,
-                                  southeast_terrain->position().z};
+                                  southeast_terrain->position_z};
       const glm::vec3 scale = {terrain.scale().x, terrain.scale().y,
-                               southeast_terrain->scale().z};
+                               southeast_terrain->scale_z};
 
       const auto x = width;
       const auto y = height;
 
-      const auto *heightmap =
-          southeast_terrain->terrain_map->mips[0].as<std::uint16_t>();
+      const auto &heightmap = southeast_terrain->first_row;
 
       mesh->vertices.push_back(
           {glm::vec3{x, y, heightmap[0]} * scale + position,
@@ -355,15 +507,115 @@ auto UnrealLoader::load_terrain_entities(
   return entities;
 }
 
+auto UnrealLoader::load_geodata_terrain(
+    const unreal::TerrainInfoActor &terrain) const -> geodata::Terrain {
+
+  const auto width = terrain.terrain_map->u_size;
+  const auto height = terrain.terrain_map->v_size;
+
+  const auto *heightmap = terrain.terrain_map->mips[0].as<std::uint16_t>();
+
+  const auto position = to_vec3(terrain.position());
+  const auto scale = to_vec3(terrain.scale());
+
+  // Size with edges
+  geodata::Terrain geodata_terrain{};
+  geodata_terrain.origin = {position.x, position.y};
+  geodata_terrain.scale = {scale.x, scale.y};
+  geodata_terrain.width = width + 1;
+  geodata_terrain.height = height + 1;
+  geodata_terrain.heights.assign((width + 1) * (height + 1), 0.0f);
+  geodata_terrain.quads.assign(width * height, 0);
+
+  const auto set_height = [&geodata_terrain](int x, int y, float value,
+                                             float position_z, float scale_z) {
+    geodata_terrain.heights[x + y * geodata_terrain.width] =
+        value * scale_z + position_z;
+  };
+
+  const auto set_quad = [&geodata_terrain](int x, int y, std::uint8_t flags) {
+    geodata_terrain.quads[x + y * (geodata_terrain.width - 1)] = flags;
+  };
+
+  for (auto y = 0; y < height; ++y) {
+    for (auto x = 0; x < width; ++x) {
+      set_height(x, y, heightmap[y * width + x], position.z, scale.z);
+    }
+  }
+
+  for (auto y = 0; y < height - 1; ++y) {
+    for (auto x = 0; x < width - 1; ++x) {
+      if (!terrain.quad_visibility_bitmap[x + y * width]) {
+        continue;
+      }
+
+      set_quad(x, y,
+               geodata::TERRAIN_QUAD_VISIBLE |
+                   (terrain.edge_turn_bitmap[x + y * width]
+                        ? geodata::TERRAIN_QUAD_EDGE_TURN
+                        : 0));
+    }
+  }
+
+  // South
+  const auto south_terrain =
+      load_side_terrain(terrain.map_x, terrain.map_y + 1);
+
+  if (south_terrain != nullptr) {
+    for (auto x = 0; x < width; ++x) {
+      set_height(x, height, south_terrain->first_row[x],
+                 south_terrain->position_z, south_terrain->scale_z);
+
+      if (x != width - 1) {
+        set_quad(x, height - 1,
+                 geodata::TERRAIN_QUAD_VISIBLE |
+                     geodata::TERRAIN_QUAD_EDGE_TURN);
+      }
+    }
+  }
+
+  // East
+  const auto east_terrain = load_side_terrain(terrain.map_x + 1, terrain.map_y);
+
+  if (east_terrain != nullptr) {
+    for (auto y = 0; y < height; ++y) {
+      set_height(width, y, east_terrain->first_column[y],
+                 east_terrain->position_z, east_terrain->scale_z);
+
+      if (y != height - 1) {
+        set_quad(width - 1, y,
+                 geodata::TERRAIN_QUAD_VISIBLE |
+                     geodata::TERRAIN_QUAD_EDGE_TURN);
+      }
+    }
+  }
+
+  // Southeast
+  const auto southeast_terrain =
+      load_side_terrain(terrain.map_x + 1, terrain.map_y + 1);
+
+  if (southeast_terrain != nullptr) {
+    set_height(width, height, southeast_terrain->first_row[0],
+               southeast_terrain->position_z, southeast_terrain->scale_z);
+
+    // Corner quad uses south and east edges too
+    if (south_terrain != nullptr && east_terrain != nullptr) {
+      set_quad(width - 1, height - 1, geodata::TERRAIN_QUAD_VISIBLE);
+    }
+  }
+
+  return geodata_terrain;
+}
+
 auto UnrealLoader::load_mesh_actor_entities(
     const unreal::Package &package) const -> std::vector<Entity<EntityMesh>> {
 
   std::vector<Entity<EntityMesh>> entities;
 
   std::vector<std::shared_ptr<unreal::StaticMeshActor>> mesh_actors;
-  package.load_objects("StaticMeshActor", mesh_actors);
-  package.load_objects("MovableStaticMeshActor", mesh_actors);
-  package.load_objects("L2MovableStaticMeshActor", mesh_actors);
+  package.load_objects({"StaticMeshActor", "MovableStaticMeshActor",
+                        "L2MovableStaticMeshActor"},
+                       mesh_actors);
 
   for (const auto &mesh_actor : mesh_actors) {
     if (mesh_actor->delete_me || mesh_actor->hidden) {
@@ -381,18 +633,20 @@ auto UnrealLoader::load_mesh_actor_entities(
 
     const auto bounding_box = to_box(unreal_mesh->bounding_box);
 
+    std::unique_lock lock{m_mesh_mutex};
+
     const auto &mesh_name = unreal_mesh->full_name();
-    auto cached_mesh = m_mesh_cache.find(mesh_name);
-    auto cached_bb_mesh = m_bb_mesh_cache.find(mesh_name);
+    const auto cached_mesh = m_mesh_cache.try_emplace(mesh_name).first;
 
-    if (cached_bb_mesh == m_bb_mesh_cache.end()) {
-      const auto bb_mesh = bounding_box_mesh(SURFACE_STATIC_MESH, bounding_box);
-      cached_bb_mesh = m_bb_mesh_cache.insert({mesh_name, bb_mesh}).first;
-    }
+    if (cached_mesh->second.mesh != nullptr) {
+      ++m_mesh_statistics.hits;
+    } else {
+      ++m_mesh_statistics.misses;
 
-    if (cached_mesh == m_mesh_cache.end()) {
       const auto mesh = std::make_shared<EntityMesh>();
-      cached_mesh = m_mesh_cache.insert({mesh_name, mesh}).first;
+      const auto bb_mesh = bounding_box_mesh(SURFACE_STATIC_MESH, bounding_box);
+      cached_mesh->second.mesh = mesh;
+      cached_mesh->second.bb_mesh = bb_mesh;
 
       // Bounding box
       mesh->bounding_box = bounding_box;
@@ -454,15 +708,29 @@ auto UnrealLoader::load_mesh_actor_entities(
 
         mesh->surfaces.push_back(surface);
       }
+
+      if (m_simple_collision) {
+        load_collision_model(unreal_mesh, *mesh_actor, *mesh);
+      }
+
+      const auto size = mesh_size(*mesh) + mesh_size(*bb_mesh);
+      cached_mesh->second.size += size;
+      m_mesh_statistics.resident_bytes += size;
     }
 
+    cached_mesh->second.last_used = m_map_counter;
+
+    const auto static_mesh = cached_mesh->second.mesh;
+    const auto static_bb_mesh = cached_mesh->second.bb_mesh;
+    lock.unlock();
+
     // Static mesh entity
-    Entity entity{cached_mesh->second};
+    Entity entity{static_mesh};
     place_actor(*mesh_actor, entity);
     entities.push_back(std::move(entity));
 
     // Bounding box entity
-    Entity bb_entity{cached_bb_mesh->second};
+    Entity bb_entity{static_bb_mesh};
     bb_entity.wireframe = true;
     place_actor(*mesh_actor, bb_entity);
     entities.push_back(std::move(bb_entity));
@@ -515,6 +783,197 @@ auto UnrealLoader::load_volume_entities(
   return entities;
 }
 
+void UnrealLoader::load_geodata_mesh_actors(
+    const unreal::Package &package,
+    std::vector<geodata::Entity> &entities) const {
+
+  std::vector<std::shared_ptr<unreal::StaticMeshActor>> mesh_actors;
+  package.load_objects({"StaticMeshActor", "MovableStaticMeshActor",
+                        "L2MovableStaticMeshActor"},
+                       mesh_actors);
+
+  for (const auto &mesh_actor : mesh_actors) {
+    if (mesh_actor->delete_me || mesh_actor->hidden ||
+        !collides(*mesh_actor)) {
+
+      continue;
+    }
+
+    const auto &unreal_mesh = mesh_actor->static_mesh;
+
+    if (!unreal_mesh) {
+      utils::Log(utils::LOG_WARN, "App")
+          << "No static mesh for actor: " << mesh_actor->full_name()
+          << std::endl;
+      continue;
+    }
+
+    std::unique_lock lock{m_mesh_mutex};
+
+    const auto &mesh_name = unreal_mesh->full_name();
+    const auto cached_mesh = m_mesh_cache.try_emplace(mesh_name).first;
+
+    if (cached_mesh->second.geodata_mesh != nullptr) {
+      ++m_mesh_statistics.hits;
+    } else {
+      ++m_mesh_statistics.misses;
+
+      const auto mesh = load_geodata_mesh(unreal_mesh);
+      cached_mesh->second.geodata_mesh = mesh;
+
+      const auto size = mesh_size(*mesh);
+      cached_mesh->second.size += size;
+      m_mesh_statistics.resident_bytes += size;
+    }
+
+    cached_mesh->second.last_used = m_map_counter;
+
+    const auto mesh = cached_mesh->second.geodata_mesh;
+    lock.unlock();
+
+    if (mesh->indices.empty()) {
+      continue;
+    }
+
+    entities.push_back({mesh, actor_matrix(*mesh_actor)});
+  }
+}
+
+void UnrealLoader::load_geodata_bsps(
+    const unreal::Package &package, const geometry::Box &map_bounding_box,
+    std::vector<geodata::Entity> &entities) const {
+
+  std::vector<std::shared_ptr<unreal::Level>> levels;
+  package.load_objects("Level", levels);
+  ASSERT(!levels.empty(), "App", "No levels in package");
+
+  for (const auto &level : levels) {
+    geodata::Mesh mesh{};
+    mesh.instance_matrices.push_back(glm::mat4{1.0f});
+    load_model_geometry(level->model, map_bounding_box, true, mesh);
+
+    if (!mesh.indices.empty()) {
+      entities.push_back({std::make_shared<geodata::Mesh>(std::move(mesh)),
+                          glm::mat4{1.0f}});
+    }
+  }
+}
+
+void UnrealLoader::load_geodata_volumes(
+    const unreal::Package &package, const geometry::Box &map_bounding_box,
+    std::vector<geodata::Entity> &entities) const {
+
+  std::vector<std::shared_ptr<unreal::VolumeActor>> volumes;
+  package.load_objects("BlockingVolume", volumes);
+
+  for (const auto &volume : volumes) {
+    if (!volume->brush) {
+      continue;
+    }
+
+    geodata::Mesh mesh{};
+    mesh.instance_matrices.push_back(glm::mat4{1.0f});
+    load_model_geometry(volume->brush, map_bounding_box, false, mesh);
+
+    if (!mesh.indices.empty()) {
+      entities.push_back({std::make_shared<geodata::Mesh>(std::move(mesh)),
+                          actor_matrix(*volume)});
+    }
+  }
+}
+
+auto UnrealLoader::load_geodata_mesh(const unreal::StaticMesh &unreal_mesh)
+    const -> std::shared_ptr<geodata::Mesh> {
+
+  const auto mesh = std::make_shared<geodata::Mesh>();
+  mesh->instance_matrices.push_back(glm::mat4{1.0f});
+
+  // See load_collision_model
+  if (m_simple_collision && unreal_mesh.use_simple_box_collision &&
+      unreal_mesh.collision_model) {
+
+    load_model_geometry(unreal_mesh.collision_model,
+                        to_box(unreal_mesh.bounding_box), false, *mesh);
+
+    if (!mesh->indices.empty()) {
+      return mesh;
+    }
+  }
+
+  for (const auto &vertex : unreal_mesh.vertex_stream.vertices) {
+    mesh->vertices.push_back(
+        {to_vec3(vertex.location), to_vec3(vertex.normal)});
+  }
+
+  for (std::size_t i = 0; i < unreal_mesh.surfaces.size(); ++i) {
+    const auto &surface = unreal_mesh.surfaces[i];
+
+    if (surface.triangle_max == 0 ||
+        !unreal_mesh.materials[i].enable_collision) {
+
+      continue;
+    }
+
+    for (auto j = 0; j < surface.triangle_max; ++j) {
+      const auto *indices =
+          &unreal_mesh.index_stream.indices[surface.first_index + j * 3];
+
+      mesh->indices.push_back(indices[2]);
+      mesh->indices.push_back(indices[1]);
+      mesh->indices.push_back(indices[0]);
+    }
+  }
+
+  return mesh;
+}
+
+void UnrealLoader::load_model_geometry(const unreal::Model &model,
+                                       const geometry::Box &map_bounding_box,
+                                       bool check_bounds,
+                                       geodata::Mesh &mesh) const {
+
+  for (const auto &node : model.nodes) {
+    if ((node.flags & unreal::NF_Passable) != 0) {
+      continue;
+    }
+
+    if (check_bounds && check_bsp_node_bounds(model, node, map_bounding_box)) {
+      continue;
+    }
+
+    const auto &unreal_surface = model.surfaces[node.surface_index];
+
+    if ((unreal_surface.polygon_flags & unreal::PF_Passable) != 0) {
+      continue;
+    }
+
+    const auto normal = to_vec3(model.vectors[unreal_surface.normal_index]);
+    const auto vertex_offset = mesh.vertices.size();
+
+    for (auto i = 0; i < node.vertex_count; ++i) {
+      const auto index =
+          model.vertices[node.vertex_pool_index + i].vertex_index;
+      mesh.vertices.push_back({to_vec3(model.points[index]), normal});
+    }
+
+    for (auto i = 2; i < node.vertex_count; ++i) {
+      mesh.indices.push_back(vertex_offset);
+      mesh.indices.push_back(vertex_offset + i - 1);
+      mesh.indices.push_back(vertex_offset + i);
+    }
+
+    // Back faces of two-sided polygons are emitted the same way as for
+    // rendering, so built geodata matches the preview
+    if ((unreal_surface.polygon_flags & unreal::PF_TwoSided) != 0) {
+      for (auto i = 2; i < node.vertex_count; ++i) {
+        mesh.indices.push_back(vertex_offset);
+        mesh.indices.push_back(vertex_offset + i);
+        mesh.indices.push_back(vertex_offset + i - 1);
+      }
+    }
+  }
+}
+
 auto UnrealLoader::load_model_entity(const unreal::Model &model,
                                      const geometry::Box &map_bounding_box,
                                      bool check_bounds) const
@@ -642,18 +1101,70 @@ void UnrealLoader::place_actor(const unreal::Actor &actor,
   entity.scale = to_vec3(actor.scale());
 }
 
+auto UnrealLoader::actor_matrix(const unreal::Actor &actor) const
+    -> glm::mat4 {
+
+  return geometry::transformation_matrix(
+      glm::mat4{1.0f}, to_vec3(actor.position()),
+      to_vec3(actor.rotation.vector()), to_vec3(actor.scale()));
+}
+
 // Reference:
 // https://docs.unrealengine.com/udk/Two/StaticMeshCollisionReference.html
+auto UnrealLoader::collides(const unreal::StaticMeshActor &mesh_actor) const
+    -> bool {
+
+  return mesh_actor.collide_actors && mesh_actor.block_actors &&
+         mesh_actor.block_players;
+}
+
 auto UnrealLoader::collides(const unreal::StaticMeshActor &mesh_actor,
                             const unreal::StaticMeshMaterial &material) const
     -> bool {
 
-  if (!mesh_actor.collide_actors || !mesh_actor.block_actors ||
-      !mesh_actor.block_players) {
-    return false;
+  return collides(mesh_actor) && material.enable_collision;
+}
+
+// Players collide with the collision model instead of triangles if the mesh
+// has one and uses simple box collision, materials don't matter then
+void UnrealLoader::load_collision_model(
+    const unreal::StaticMesh &unreal_mesh,
+    const unreal::StaticMeshActor &mesh_actor, EntityMesh &mesh) const {
+
+  if (!unreal_mesh.use_simple_box_collision || !unreal_mesh.collision_model) {
+    return;
   }
 
-  return material.enable_collision;
+  // Collision model is in the mesh space, so it's never out of bounds
+  const auto entity =
+      load_model_entity(unreal_mesh.collision_model, mesh.bounding_box, false);
+
+  if (!entity.has_value()) {
+    return;
+  }
+
+  const auto &collision_mesh = *entity->mesh;
+  const auto vertex_offset = mesh.vertices.size();
+  const auto index_offset = mesh.indices.size();
+
+  mesh.vertices.insert(mesh.vertices.end(), collision_mesh.vertices.begin(),
+                       collision_mesh.vertices.end());
+
+  for (const auto index : collision_mesh.indices) {
+    mesh.indices.push_back(vertex_offset + index);
+  }
+
+  Surface surface{};
+  surface.type = SURFACE_STATIC_MESH | SURFACE_COLLISION;
+  surface.index_offset = index_offset;
+  surface.index_count = collision_mesh.indices.size();
+  surface.material.color = {1.0f, 0.6f, 0.6f};
+
+  if (!collides(mesh_actor)) {
+    surface.type |= SURFACE_PASSABLE;
+  }
+
+  mesh.surfaces.push_back(surface);
 }
 
 auto UnrealLoader::bounding_box_mesh(std::uint64_t type,
@@ -702,6 +1213,21 @@ auto UnrealLoader::bounding_box_mesh(std::uint64_t type,
   return mesh;
 }
 
+auto UnrealLoader::mesh_size(const EntityMesh &mesh) const -> std::size_t {
+  return mesh.vertices.size() * sizeof(Vertex) +
+         mesh.indices.size() * sizeof(unsigned int) +
+         mesh.surfaces.size() * sizeof(Surface) +
+         mesh.instance_matrices.size() * sizeof(glm::mat4);
+}
+
+auto UnrealLoader::mesh_size(const geodata::Mesh &mesh) const
+    -> std::size_t {
+
+  return mesh.vertices.size() * sizeof(geodata::Vertex) +
+         mesh.indices.size() * sizeof(unsigned int) +
+         mesh.instance_matrices.size() * sizeof(glm::mat4);
+}
+
 auto UnrealLoader::check_bsp_node_bounds(
     const unreal::Model &model, const unreal::BSPNode &node,
     const geometry::Box &map_bounding_box) const -> bool {
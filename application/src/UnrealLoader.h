@@ -11,10 +11,20 @@
 #include <unreal/StaticMesh.h>
 #include <unreal/Terrain.h>
 
+#include <geodata/Entity.h>
+#include <geodata/Map.h>
+#include <geodata/Terrain.h>
+
 #include <geometry/Box.h>
 
+#include <utils/ThreadPool.h>
+
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -22,23 +32,74 @@
 
 class UnrealLoader {
 public:
-  explicit UnrealLoader(const std::filesystem::path &root_path);
+  // Static meshes with a collision model collide with it instead of render
+  // triangles if simple collision is enabled
+  explicit UnrealLoader(const std::filesystem::path &root_path,
+                        const unreal::CacheConfig &cache_config = {},
+                        bool simple_collision = false);
 
   auto load_map(const std::string &name) const -> Map;
 
+  // Loads only the geometry geodata is built from, without render data and
+  // intermediate meshes. Packages the map was loaded from are returned too.
+  auto load_geodata_map(const std::string &name,
+                        std::vector<std::string> &packages,
+                        utils::ThreadPool *thread_pool) const
+      -> std::optional<geodata::Map>;
+
+  // Evicts least recently used static meshes which aren't used by any
+  // loaded map until the cache fits in the budget
+  void evict_unused_meshes(std::size_t memory_budget) const;
+
+  auto find_package(const std::string &name) const
+      -> const unreal::PackageFile *;
+
+  auto package_statistics() const -> unreal::CacheStatistics;
+  auto mesh_statistics() const -> unreal::CacheStatistics;
+
+  auto simple_collision() const -> bool { return m_simple_collision; }
+
 private:
-  unreal::PackageLoader m_package_loader;
+  // Render and geodata meshes are loaded on demand, so either can be null
+  struct CachedMesh {
+    std::shared_ptr<EntityMesh> mesh;
+    std::shared_ptr<EntityMesh> bb_mesh;
+    std::shared_ptr<geodata::Mesh> geodata_mesh;
+    std::size_t size;
+    std::uint64_t last_used;
+  };
 
-  mutable std::unordered_map<std::string, std::shared_ptr<EntityMesh>>
-      m_mesh_cache;
-  mutable std::unordered_map<std::string, std::shared_ptr<EntityMesh>>
-      m_bb_mesh_cache;
+  unreal::PackageLoader m_package_loader;
+  const bool m_simple_collision;
+
+  // Static meshes by full name, shared between maps and guarded by the mutex,
+  // so maps can be loaded concurrently
+  mutable std::mutex m_mesh_mutex;
+  mutable std::unordered_map<std::string, CachedMesh> m_mesh_cache;
+  mutable unreal::CacheStatistics m_mesh_statistics;
+  mutable std::uint64_t m_map_counter;
+
+  // Heightmap edges of a neighbour map used to stitch the map with it
+  struct SideTerrain {
+    float position_z;
+    float scale_z;
+    std::vector<std::uint16_t> first_row;
+    std::vector<std::uint16_t> first_column;
+  };
+
+  // Side terrains by package name, every neighbour package is read once for
+  // all maps around it. Null if there's no usable terrain.
+  mutable std::mutex m_side_terrain_mutex;
+  mutable std::unordered_map<
+      std::string, std::shared_future<std::shared_ptr<const SideTerrain>>>
+      m_side_terrains;
 
-  auto load_map_package(int x, int y) const -> std::optional<unreal::Package>;
   auto load_terrain(const unreal::Package &package) const
       -> std::shared_ptr<unreal::TerrainInfoActor>;
   auto load_side_terrain(int x, int y) const
-      -> std::shared_ptr<unreal::TerrainInfoActor>;
+      -> std::shared_ptr<const SideTerrain>;
+  auto read_side_terrain(const std::string &package_name) const
+      -> std::shared_ptr<const SideTerrain>;
 
   auto load_terrain_entities(const unreal::TerrainInfoActor &terrain) const
       -> std::vector<Entity<EntityMesh>>;
@@ -51,6 +112,27 @@ private:
                             const geometry::Box &map_bounding_box) const
       -> std::vector<Entity<EntityMesh>>;
 
+  // Geodata heightmap, quads without neighbour terrain are hidden
+  auto load_geodata_terrain(const unreal::TerrainInfoActor &terrain) const
+      -> geodata::Terrain;
+  void load_geodata_mesh_actors(const unreal::Package &package,
+                                std::vector<geodata::Entity> &entities) const;
+  void load_geodata_bsps(const unreal::Package &package,
+                         const geometry::Box &map_bounding_box,
+                         std::vector<geodata::Entity> &entities) const;
+  void load_geodata_volumes(const unreal::Package &package,
+                            const geometry::Box &map_bounding_box,
+                            std::vector<geodata::Entity> &entities) const;
+
+  // Triangles of the static mesh which players collide with
+  auto load_geodata_mesh(const unreal::StaticMesh &unreal_mesh) const
+      -> std::shared_ptr<geodata::Mesh>;
+
+  // Appends solid BSP polygons of the model to the mesh
+  void load_model_geometry(const unreal::Model &model,
+                           const geometry::Box &map_bounding_box,
+                           bool check_bounds, geodata::Mesh &mesh) const;
+
   auto load_model_entity(const unreal::Model &model,
                          const geometry::Box &map_bounding_box,
                          bool check_bounds = true) const
@@ -58,13 +140,23 @@ private:
 
   void place_actor(const unreal::Actor &actor,
                    Entity<EntityMesh> &entity) const;
+  auto actor_matrix(const unreal::Actor &actor) const -> glm::mat4;
 
+  auto collides(const unreal::StaticMeshActor &mesh_actor) const -> bool;
   auto collides(const unreal::StaticMeshActor &mesh_actor,
                 const unreal::StaticMeshMaterial &material) const -> bool;
 
+  // Appends the collision model surface if the mesh uses simple collision
+  void load_collision_model(const unreal::StaticMesh &unreal_mesh,
+                            const unreal::StaticMeshActor &mesh_actor,
+                            EntityMesh &mesh) const;
+
   auto bounding_box_mesh(std::uint64_t type, const geometry::Box &box) const
       -> std::shared_ptr<EntityMesh>;
 
+  auto mesh_size(const EntityMesh &mesh) const -> std::size_t;
+  auto mesh_size(const geodata::Mesh &mesh) const -> std::size_t;
+
   auto check_bsp_node_bounds(const unreal::Model &model,
                              const unreal::BSPNode &node,
                              const geometry::Box &map_bounding_box) const
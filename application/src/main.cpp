@@ -18,6 +18,35 @@ auto main(int argc, char **argv) -> int {
       ("client-root", "Path to the Lineage II client",                       //
        cxxopts::value<std::filesystem::path>())                              //
                                                                              //
+      ("package-cache",                                                      //
+       "Directory to cache decrypted client packages in",                    //
+       cxxopts::value<std::filesystem::path>())                              //
+                                                                             //
+      ("package-budget",                                                     //
+       "Memory budget for loaded client packages in MB (0 - unlimited)",     //
+       cxxopts::value<std::size_t>()->default_value("0"))                    //
+                                                                             //
+      ("jobs", "Number of maps built concurrently",                          //
+       cxxopts::value<std::size_t>()->default_value("1"))                    //
+                                                                             //
+      ("memory-limit",                                                       //
+       "Memory limit for geodata building in MB (0 - unlimited)",            //
+       cxxopts::value<std::size_t>()->default_value("0"))                    //
+                                                                             //
+      ("force", "Rebuild maps even if they are up to date")                  //
+                                                                             //
+      ("map-cache", "Directory to cache prebuilt maps in",                   //
+       cxxopts::value<std::filesystem::path>())                              //
+                                                                             //
+      ("sweep",                                                              //
+       "Build maps with several actor settings, comma separated list of "    //
+       "<height>:<radius>:<min climb>:<max climb>",                          //
+       cxxopts::value<std::vector<std::string>>())                           //
+                                                                             //
+      ("simple-collision",                                                   //
+       "Use collision models of static meshes instead of their triangles "   //
+       "where available")                                                    //
+                                                                             //
       ("log-level",                                                          //
        "Log level (0 - none, 1 - fatal, 2 - error, 3 - warn, 4 - info, 5 - " //
        "debug, 6 - all)",                                                    //
@@ -69,6 +98,47 @@ auto main(int argc, char **argv) -> int {
     return EXIT_FAILURE;
   }
 
+  // Package cache
+  unreal::CacheConfig cache_config{};
+  if (input.count("package-cache") > 0) {
+    cache_config.directory = input["package-cache"].as<std::filesystem::path>();
+  }
+
+  cache_config.memory_budget =
+      input["package-budget"].as<std::size_t>() * 1024 * 1024;
+
+  // Build
+  BuildConfig build_config{};
+  build_config.jobs = input["jobs"].as<std::size_t>();
+  build_config.memory_limit =
+      input["memory-limit"].as<std::size_t>() * 1024 * 1024;
+  build_config.force = input.count("force") > 0;
+  build_config.simple_collision = input.count("simple-collision") > 0;
+
+  if (input.count("map-cache") > 0) {
+    build_config.map_cache = input["map-cache"].as<std::filesystem::path>();
+  }
+
+  if (input.count("sweep") > 0) {
+    for (const auto &entry : input["sweep"].as<std::vector<std::string>>()) {
+      BuildConfig::SweepSettings sweep_settings{};
+      auto separator = ':';
+      std::istringstream stream{entry};
+      stream >> sweep_settings.actor_height >> separator >>
+          sweep_settings.actor_radius >> separator >>
+          sweep_settings.min_walkable_climb >> separator >>
+          sweep_settings.max_walkable_climb;
+
+      if (stream.fail() || !stream.eof()) {
+        utils::Log(utils::LOG_ERROR)
+            << "Invalid sweep settings: " << entry << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      build_config.sweep.push_back(sweep_settings);
+    }
+  }
+
   // Maps
   const auto &maps = input.unmatched();
   if (maps.empty()) {
@@ -80,9 +150,9 @@ auto main(int argc, char **argv) -> int {
   // Run application
   const Application application;
   if (preview) {
-    application.preview(client_root, maps);
+    application.preview(client_root, cache_config, maps);
   } else if (build) {
-    application.build(client_root, maps);
+    application.build(client_root, cache_config, build_config, maps);
   } else {
     ASSERT(false, "App", "Unknown command");
   }
@@ -28,14 +28,18 @@
 #include <rendering/Vertex.h>
 
 #include <geodata/Builder.h>
+#include <geodata/ExportBuffer.h>
 #include <geodata/Exporter.h>
 #include <geodata/Geodata.h>
 #include <geodata/Loader.h>
 #include <geodata/Map.h>
+#include <geodata/MapCache.h>
 
 #include <utils/Assert.h>
 #include <utils/Log.h>
+#include <utils/Memory.h>
 #include <utils/NonCopyable.h>
+#include <utils/ThreadPool.h>
 
 #include <geometry/Box.h>
 #include <geometry/Transformation.h>
@@ -53,12 +57,18 @@
 
 #include <cxxopts.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <sstream>
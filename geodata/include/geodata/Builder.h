@@ -5,6 +5,12 @@
 #include "Geodata.h"
 #include "Map.h"
 
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+struct rcHeightfield;
+
 namespace geodata {
 
 class Builder {
@@ -12,8 +18,27 @@ public:
   auto build(const Map &map, const BuilderSettings &settings) const
       -> const ExportBuffer &;
 
+  // Index of the settings in the sweep and the buffer built with them
+  using SweepHandler =
+      std::function<void(std::size_t index, const ExportBuffer &buffer)>;
+
+  // Builds the map for every settings in the sweep, rasterizing it only once.
+  // Settings must share the walkable angle and cell sizes.
+  void build(const Map &map, const std::vector<BuilderSettings> &sweep,
+             const SweepHandler &handler) const;
+
+  // Rough estimate of memory allocated while building the map, the export
+  // buffer isn't included
+  static auto estimate_memory_usage(const Map &map,
+                                    const BuilderSettings &settings)
+      -> std::size_t;
+
 private:
   mutable ExportBuffer m_export_buffer;
+
+  // Converts the heightfield with calculated NSWE into the export buffer
+  void export_heightfield(const rcHeightfield &hf, const Map &map,
+                          const BuilderSettings &settings) const;
 };
 
 } // namespace geodata
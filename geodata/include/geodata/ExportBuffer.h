@@ -2,6 +2,7 @@
 
 #include <geodata/Geodata.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -27,6 +28,9 @@ public:
 
   explicit ExportBuffer();
 
+  // Size of the buffer, it's allocated once and doesn't depend on a map
+  static auto memory_size() -> std::size_t;
+
   void reset(const Geodata &geodata);
 
   // Not cheap operation
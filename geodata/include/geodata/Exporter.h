@@ -14,6 +14,8 @@ public:
   void export_l2j_geodata(const ExportBuffer &export_buffer,
                           const std::string &name) const;
 
+  auto l2j_path(const std::string &name) const -> std::filesystem::path;
+
 private:
   const std::filesystem::path m_root_path;
 };
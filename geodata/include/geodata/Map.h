@@ -1,8 +1,10 @@
 #pragma once
 
 #include "Entity.h"
+#include "Terrain.h"
 
 #include <utils/NonCopyable.h>
+#include <utils/ThreadPool.h>
 
 #include <geometry/Box.h>
 #include <geometry/Intersection.h>
@@ -10,14 +12,33 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 namespace geodata {
 
-// Input coordinate system is converted from Z-up to Y-up
+// Placement of a mesh shared by several entities
+struct MeshInstance {
+  std::uint32_t mesh;
+
+  // Number of map indices added before the instance, instances are
+  // rasterized in the same order as entities were added
+  std::uint64_t index_offset;
+
+  glm::mat4 model_matrix;
+  glm::mat3 normal_matrix;
+};
+
+// Input coordinate system is converted from Z-up to Y-up, except for the
+// terrain heightmap which is kept as is. Meshes placed more than once are
+// kept once in mesh space with per-instance transforms, other entities are
+// transformed into the map vertices and indices.
 class Map : public utils::NonCopyable {
 public:
   explicit Map(const std::string &name, const geometry::Box &bounding_box);
@@ -25,6 +46,18 @@ public:
 
   void add(const Entity &entity);
 
+  // Same as adding entities one by one, but the map grows once and entity
+  // instances are transformed in parallel on the thread pool, if it's given.
+  // The calling thread takes part, the pool must not wait for it. Instances
+  // and triangles outside of the bounding box are dropped, they can't be
+  // rasterized anyway. Meshes placed inside of the map more than once in the
+  // batch, or instanced by previous batches, become mesh instances.
+  void add(const std::vector<Entity> &entities,
+           utils::ThreadPool *thread_pool = nullptr);
+
+  // Terrain is rasterized directly from the heightmap, without triangulation
+  void add(const Terrain &terrain);
+
   auto name() const -> const std::string &;
   auto bounding_box() const -> geometry::Box;
 
@@ -32,12 +65,29 @@ public:
 
   auto vertices() const -> const std::vector<glm::vec3> &;
   auto indices() const -> const std::vector<unsigned int> &;
+  auto meshes() const -> const std::vector<std::shared_ptr<const Mesh>> &;
+  auto instances() const -> const std::vector<MeshInstance> &;
+  auto terrain() const -> const std::optional<Terrain> &;
+
+  // Instance geometry in the map space, triangles are wound the same way as
+  // for entities transformed into the map
+  void instance_geometry(const MeshInstance &instance,
+                         std::vector<glm::vec3> &vertices,
+                         std::vector<unsigned int> &indices) const;
+  auto instance_triangle(const MeshInstance &instance,
+                         std::size_t triangle) const
+      -> std::array<glm::vec3, 3>;
+
+  friend class MapCache;
 
 private:
   const std::string m_name;
   const geometry::Box m_bounding_box;
   std::vector<glm::vec3> m_vertices;
   std::vector<unsigned int> m_indices;
+  std::vector<std::shared_ptr<const Mesh>> m_meshes;
+  std::vector<MeshInstance> m_instances;
+  std::optional<Terrain> m_terrain;
 };
 
 } // namespace geodata
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Map.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace geodata {
+
+// On-disk cache of prebuilt maps, so geodata can be rebuilt with other
+// settings without loading the client. Entries store the sources the map was
+// loaded from, callers decide whether they are still fresh.
+class MapCache {
+public:
+  struct SourceFile {
+    std::string name;
+    std::uint64_t size;
+    std::int64_t modified;
+  };
+
+  struct Sources {
+    std::uint32_t loader_version;
+    std::string loader_options;
+    std::vector<SourceFile> files;
+  };
+
+  struct Entry {
+    Map map;
+    Sources sources;
+  };
+
+  explicit MapCache(const std::filesystem::path &directory);
+
+  // Returns nothing if there's no readable entry for the map, or its sources
+  // aren't fresh
+  auto load(const std::string &name,
+            const std::function<bool(const Sources &sources)> &is_fresh) const
+      -> std::optional<Entry>;
+
+  void store(const Map &map, const Sources &sources) const;
+
+private:
+  static constexpr std::uint32_t CACHE_MAGIC = 0x4d4d324c; // "L2MM"
+  static constexpr std::uint32_t CACHE_VERSION = 5;
+
+  const std::filesystem::path m_directory;
+
+  auto entry_path(const std::string &name) const -> std::filesystem::path;
+};
+
+} // namespace geodata
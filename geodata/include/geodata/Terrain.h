@@ -0,0 +1,87 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace geodata {
+
+enum TerrainQuadFlags {
+  TERRAIN_QUAD_VISIBLE = 0x1,
+
+  // Quad is split along the (x, y + 1) - (x + 1, y) diagonal instead of the
+  // (x, y) - (x + 1, y + 1) one
+  TERRAIN_QUAD_EDGE_TURN = 0x2,
+};
+
+// Terrain heightmap in the input (Z-up) coordinate system. Vertex (x, y) is
+// placed at origin + {x, y} * scale with the height of heights[x + y * width].
+struct Terrain {
+  glm::vec2 origin;
+  glm::vec2 scale;
+  int width;
+  int height;
+  std::vector<float> heights;
+
+  // Flags of (width - 1) * (height - 1) quads
+  std::vector<std::uint8_t> quads;
+
+  explicit Terrain()
+      : origin{}, scale{}, width{0}, height{0}, heights{}, quads{} {}
+
+  auto vertex(int x, int y) const -> glm::vec3 {
+    return {origin.x + x * scale.x, origin.y + y * scale.y,
+            heights[x + y * width]};
+  }
+
+  auto quad(int x, int y) const -> std::uint8_t {
+    return quads[x + y * (width - 1)];
+  }
+
+  // Two triangles of the quad, vertices are in the same order as the
+  // triangles would be in a mesh
+  auto quad_triangles(int x, int y) const
+      -> std::array<std::array<glm::vec3, 3>, 2> {
+
+    const auto v00 = vertex(x + 0, y + 0);
+    const auto v10 = vertex(x + 1, y + 0);
+    const auto v01 = vertex(x + 0, y + 1);
+    const auto v11 = vertex(x + 1, y + 1);
+
+    if ((quad(x, y) & TERRAIN_QUAD_EDGE_TURN) == 0) {
+      return {{{v00, v10, v11}, {v00, v11, v01}}};
+    }
+
+    return {{{v01, v00, v10}, {v01, v10, v11}}};
+  }
+
+  // Calls the function for every visible quad overlapped by the rectangle,
+  // quads only touching it are skipped
+  template <typename F>
+  void for_each_quad(const glm::vec2 &min, const glm::vec2 &max,
+                     F function) const {
+
+    const auto quad_min = glm::floor((min - origin) / scale);
+    const auto quad_max = glm::ceil((max - origin) / scale) - 1.0f;
+
+    const auto min_x = std::max(static_cast<int>(quad_min.x), 0);
+    const auto min_y = std::max(static_cast<int>(quad_min.y), 0);
+    const auto max_x = std::min(static_cast<int>(quad_max.x), width - 2);
+    const auto max_y = std::min(static_cast<int>(quad_max.y), height - 2);
+
+    for (auto y = min_y; y <= max_y; ++y) {
+      for (auto x = min_x; x <= max_x; ++x) {
+        if ((quad(x, y) & TERRAIN_QUAD_VISIBLE) == 0) {
+          continue;
+        }
+
+        function(x, y);
+      }
+    }
+  }
+};
+
+} // namespace geodata
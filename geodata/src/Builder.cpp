@@ -7,6 +7,9 @@
 
 namespace geodata {
 
+// Walkable surfaces seldom have more layers, caves and buildings are rare
+static constexpr auto EXPECTED_SPANS_PER_COLUMN = 4;
+
 auto Builder::build(const Map &map, const BuilderSettings &settings) const
     -> const ExportBuffer & {
 
@@ -21,7 +24,53 @@ auto Builder::build(const Map &map, const BuilderSettings &settings) const
       settings.cell_height,
   };
 
-  const auto &hf = nswe_calculator.calculate_nswe();
+  export_heightfield(nswe_calculator.calculate_nswe(), map, settings);
+  return m_export_buffer;
+}
+
+void Builder::build(const Map &map, const std::vector<BuilderSettings> &sweep,
+                    const SweepHandler &handler) const {
+
+  ASSERT(!sweep.empty(), "Geodata", "Settings sweep can't be empty");
+
+  const auto &first = sweep.front();
+
+  for (const auto &settings : sweep) {
+    ASSERT(settings.max_walkable_angle == first.max_walkable_angle &&
+               settings.cell_size == first.cell_size &&
+               settings.cell_height == first.cell_height,
+           "Geodata",
+           "Swept settings must share walkable angle and cell sizes");
+  }
+
+  // Rasterize once, only NSWE is calculated for every settings
+  NSWE nswe_calculator{
+      map,
+      first.actor_height,
+      first.actor_radius,
+      first.max_walkable_angle,
+      first.min_walkable_climb,
+      first.max_walkable_climb,
+      first.cell_size,
+      first.cell_height,
+  };
+
+  for (std::size_t i = 0; i < sweep.size(); ++i) {
+    const auto &settings = sweep[i];
+
+    if (i > 0) {
+      nswe_calculator.reset(settings.actor_height, settings.actor_radius,
+                            settings.min_walkable_climb,
+                            settings.max_walkable_climb);
+    }
+
+    export_heightfield(nswe_calculator.calculate_nswe(), map, settings);
+    handler(i, m_export_buffer);
+  }
+}
+
+void Builder::export_heightfield(const rcHeightfield &hf, const Map &map,
+                                 const BuilderSettings &settings) const {
 
   // Convert heightfield to geodata
   Geodata geodata;
@@ -99,15 +148,52 @@ auto Builder::build(const Map &map, const BuilderSettings &settings) const
         << "Black holes (points of no return): " << black_holes << std::endl;
   }
 
-  // Compress export buffer and return it
+  // Compress export buffer
   m_export_buffer.reset(geodata);
 
 #ifdef GEODATA_POST_PROCESSING
   Compressor compressor{m_export_buffer};
   compressor.compress();
 #endif
+}
 
-  return m_export_buffer;
+auto Builder::estimate_memory_usage(const Map &map,
+                                    const BuilderSettings &settings)
+    -> std::size_t {
+
+  const auto *bb_min = glm::value_ptr(map.internal_bounding_box().min());
+  const auto *bb_max = glm::value_ptr(map.internal_bounding_box().max());
+
+  auto width = 0;
+  auto height = 0;
+  rcCalcGridSize(bb_min, bb_max, settings.cell_size, &width, &height);
+
+  const auto columns = static_cast<std::size_t>(width) * height;
+
+  // Heightfield, triangle indices and caches per column, converted cells
+  const auto column_size =
+      sizeof(rcSpan *) + sizeof(std::vector<int>) +
+      sizeof(std::vector<geometry::Triangle>) + sizeof(int) +
+      EXPECTED_SPANS_PER_COLUMN * (sizeof(rcSpan) + sizeof(Cell));
+
+  // Geometry and triangle areas
+  auto geometry_size = map.vertices().size() * sizeof(glm::vec3) +
+                       map.indices().size() * sizeof(unsigned int) +
+                       map.indices().size() / 3;
+
+  for (const auto &mesh : map.meshes()) {
+    geometry_size += mesh->vertices.size() * sizeof(Vertex) +
+                     mesh->indices.size() * sizeof(unsigned int);
+  }
+
+  geometry_size += map.instances().size() * sizeof(MeshInstance);
+
+  if (const auto &terrain = map.terrain()) {
+    geometry_size += terrain->heights.size() * sizeof(float) +
+                     terrain->quads.size() * sizeof(std::uint8_t);
+  }
+
+  return columns * column_size + geometry_size;
 }
 
 } // namespace geodata
@@ -19,6 +19,12 @@ ExportBuffer::ExportBuffer()
                                                              MAP_HEIGHT_CELLS *
                                                              MAX_LAYERS} {}
 
+auto ExportBuffer::memory_size() -> std::size_t {
+  return MAP_WIDTH_BLOCKS * MAP_HEIGHT_BLOCKS * sizeof(Block) +
+         MAP_WIDTH_CELLS * MAP_HEIGHT_CELLS * sizeof(Column) +
+         MAP_WIDTH_CELLS * MAP_HEIGHT_CELLS * MAX_LAYERS * sizeof(PackedCell);
+}
+
 void ExportBuffer::reset(const Geodata &geodata) {
   std::fill(m_blocks.begin(), m_blocks.end(), Block{});
   std::fill(m_columns.begin(), m_columns.end(), Column{});
@@ -16,7 +16,7 @@ Exporter::Exporter(const std::filesystem::path &root_path)
 void Exporter::export_l2j_geodata(const ExportBuffer &buffer,
                                   const std::string &name) const {
 
-  const auto l2j_path = m_root_path / (name + ".l2j");
+  const auto l2j_path = this->l2j_path(name);
   std::ofstream output{l2j_path, std::ios::binary};
 
   L2JSerializer serializer;
@@ -26,4 +26,10 @@ void Exporter::export_l2j_geodata(const ExportBuffer &buffer,
       << "Geodata exported: " << l2j_path << std::endl;
 }
 
+auto Exporter::l2j_path(const std::string &name) const
+    -> std::filesystem::path {
+
+  return m_root_path / (name + ".l2j");
+}
+
 } // namespace geodata
@@ -19,10 +19,146 @@ Map::Map(Map &&other) noexcept
     : m_name{std::move(other.m_name)}, m_bounding_box{std::move(
                                            other.m_bounding_box)},
       m_vertices{std::move(other.m_vertices)}, m_indices{std::move(
-                                                   other.m_indices)} {}
+                                                   other.m_indices)},
+      m_meshes{std::move(other.m_meshes)}, m_instances{std::move(
+                                               other.m_instances)},
+      m_terrain{std::move(other.m_terrain)} {}
 
-void Map::add(const Entity &entity) {
-  ASSERT(entity.mesh != nullptr, "Geodata", "Entity must have mesh");
+namespace {
+
+// Output ranges of one entity instance
+struct InstanceRange {
+  const Mesh *mesh;
+  glm::mat4 model_matrix;
+  std::size_t vertex_offset;
+  std::size_t index_offset;
+
+  // Indices left after culling, written by the transform
+  std::size_t kept_index_count;
+};
+
+// Affine part of the model matrix, columns are hoisted, so transforms are
+// plain multiply-adds and loops over contiguous arrays can be vectorized
+struct AffineTransform {
+  glm::vec3 column_x;
+  glm::vec3 column_y;
+  glm::vec3 column_z;
+  glm::vec3 translation;
+
+  explicit AffineTransform(const glm::mat4 &matrix)
+      : column_x{matrix[0]}, column_y{matrix[1]}, column_z{matrix[2]},
+        translation{matrix[3]} {}
+
+  auto apply(const glm::vec3 &position) const -> glm::vec3 {
+    return column_x * position.x + column_y * position.y +
+           column_z * position.z + translation;
+  }
+};
+
+// Maps smaller than this are transformed on the calling thread
+constexpr auto parallel_vertex_count = std::size_t{1} << 16;
+
+// Meshes placed inside of the map at least this many times in a batch are
+// instanced
+constexpr auto min_mesh_instances = 2;
+
+// Instance boxes are transformed separately from their vertices, the margin
+// covers the rounding difference
+constexpr auto instance_cull_margin = 1.0f;
+
+// Inclusive, the same way Recast skips triangles outside of the heightfield
+inline auto overlaps(const glm::vec3 &min, const glm::vec3 &max,
+                     const geometry::Box &box) -> bool {
+
+  return min.x <= box.max().x && max.x >= box.min().x &&
+         min.y <= box.max().y && max.y >= box.min().y &&
+         min.z <= box.max().z && max.z >= box.min().z;
+}
+
+inline auto transform_normal(const glm::mat3 &normal_matrix,
+                             const glm::vec3 &normal) -> glm::vec3 {
+
+  return glm::normalize(normal_matrix * normal);
+}
+
+// Tries to fix winding: triangle is reversed if its vertex normals agree with
+// the normal of the reversed triangle. Only signs are compared, so vectors
+// aren't normalized, degenerate triangles keep their order.
+inline auto reverse_winding(const std::array<glm::vec3, 3> &normals,
+                            const std::array<glm::vec3, 3> &vertices)
+    -> bool {
+
+  const auto normal_sum = normals[0] + normals[1] + normals[2];
+  const auto face_normal =
+      glm::cross(vertices[2] - vertices[1], vertices[2] - vertices[0]);
+
+  return glm::dot(normal_sum, face_normal) >= 0.0f &&
+         normal_sum != glm::vec3{0.0f} && face_normal != glm::vec3{0.0f};
+}
+
+// Triangles outside of the bounding box are dropped if it's given, returns
+// the number of written indices
+auto transform_mesh(const Mesh &mesh, const glm::mat4 &model_matrix,
+                    const glm::mat3 &normal_matrix,
+                    const geometry::Box *bounding_box, glm::vec3 *vertices,
+                    unsigned int *indices, unsigned int vertex_offset,
+                    std::vector<glm::vec3> &normals) -> std::size_t {
+
+  const AffineTransform transform{model_matrix};
+
+  normals.resize(mesh.vertices.size());
+
+  for (std::size_t i = 0; i < mesh.vertices.size(); ++i) {
+    vertices[i] = transform.apply(mesh.vertices[i].position);
+    normals[i] = transform_normal(normal_matrix, mesh.vertices[i].normal);
+  }
+
+  std::size_t index_count = 0;
+
+  for (std::size_t index = 0; index < mesh.indices.size(); index += 3) {
+    const auto *triangle = &mesh.indices[index];
+
+    const std::array<glm::vec3, 3> triangle_vertices{
+        vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]]};
+
+    if (bounding_box != nullptr &&
+        !overlaps(glm::min(glm::min(triangle_vertices[0],
+                                    triangle_vertices[1]),
+                           triangle_vertices[2]),
+                  glm::max(glm::max(triangle_vertices[0],
+                                    triangle_vertices[1]),
+                           triangle_vertices[2]),
+                  *bounding_box)) {
+
+      continue;
+    }
+
+    auto *output = &indices[index_count];
+    index_count += 3;
+
+    if (reverse_winding({normals[triangle[0]], normals[triangle[1]],
+                         normals[triangle[2]]},
+                        triangle_vertices)) {
+
+      output[0] = vertex_offset + triangle[2];
+      output[1] = vertex_offset + triangle[1];
+      output[2] = vertex_offset + triangle[0];
+    } else {
+      output[0] = vertex_offset + triangle[0];
+      output[1] = vertex_offset + triangle[1];
+      output[2] = vertex_offset + triangle[2];
+    }
+  }
+
+  return index_count;
+}
+
+} // namespace
+
+void Map::add(const Entity &entity) { add(std::vector<Entity>{entity}); }
+
+void Map::add(const std::vector<Entity> &entities,
+              utils::ThreadPool *thread_pool) {
 
   // Swap Y-up with Z-up
   static constexpr auto identity = glm::mat4{
@@ -32,47 +168,234 @@ void Map::add(const Entity &entity) {
       {0.0f, 0.0f, 0.0f, 1.0f},
   };
 
-  std::vector<glm::vec3> normals;
+  // Bounds of shared meshes are calculated once
+  std::unordered_map<const Mesh *, geometry::Box> mesh_bounding_boxes;
 
-  for (const auto &instance_matrix : entity.mesh->instance_matrices) {
-    const auto vertex_count = m_vertices.size();
+  const auto mesh_bounding_box = [&mesh_bounding_boxes](const Mesh &mesh) {
+    const auto [cached_box, inserted] =
+        mesh_bounding_boxes.try_emplace(&mesh);
 
-    const auto model_matrix = identity * entity.model_matrix * instance_matrix;
-    const auto normal_matrix = glm::inverseTranspose(glm::mat3{model_matrix});
+    if (inserted) {
+      for (const auto &vertex : mesh.vertices) {
+        cached_box->second += vertex.position;
+      }
+    }
 
-    for (const auto &vertex : entity.mesh->vertices) {
-      const auto transformed_vertex =
-          model_matrix * glm::vec4{vertex.position, 1.0f};
+    return cached_box->second;
+  };
 
-      m_vertices.emplace_back(transformed_vertex);
-      normals.emplace_back(glm::normalize(normal_matrix * vertex.normal));
-    }
+  struct Placement {
+    const Entity *entity;
+    glm::mat4 model_matrix;
+  };
 
-    for (std::size_t index = 0; index < entity.mesh->indices.size();
-         index += 3) {
+  // First pass: placements inside of the map and their number per mesh
+  std::vector<Placement> placements;
+  std::unordered_map<const Mesh *, int> mesh_placements;
+  std::size_t culled_instances = 0;
 
-      const auto *indices = &entity.mesh->indices[index];
-      const auto *vertices = &m_vertices[vertex_count];
+  for (const auto &entity : entities) {
+    ASSERT(entity.mesh != nullptr, "Geodata", "Entity must have mesh");
+
+    if (entity.mesh->vertices.empty()) {
+      continue;
+    }
 
-      // Try to fix winding
-      const auto average_normal = glm::normalize(
-          (normals[indices[0]] + normals[indices[1]] + normals[indices[2]]) /
-          3.0f);
+    const auto local_box = mesh_bounding_box(*entity.mesh);
 
-      const auto face_normal = glm::triangleNormal(
-          vertices[indices[2]], vertices[indices[1]], vertices[indices[0]]);
+    for (const auto &instance_matrix : entity.mesh->instance_matrices) {
+      const auto model_matrix =
+          identity * entity.model_matrix * instance_matrix;
+      const geometry::Box box{local_box, model_matrix};
 
-      if (glm::dot(average_normal, face_normal) >= 0.0f) {
-        m_indices.push_back(vertex_count + indices[2]);
-        m_indices.push_back(vertex_count + indices[1]);
-        m_indices.push_back(vertex_count + indices[0]);
-      } else {
-        m_indices.push_back(vertex_count + indices[0]);
-        m_indices.push_back(vertex_count + indices[1]);
-        m_indices.push_back(vertex_count + indices[2]);
+      if (!overlaps(box.min() - instance_cull_margin,
+                    box.max() + instance_cull_margin, m_bounding_box)) {
+
+        ++culled_instances;
+        continue;
       }
+
+      placements.push_back({&entity, model_matrix});
+      ++mesh_placements[entity.mesh.get()];
     }
   }
+
+  // Mesh indices of instanced meshes, meshes instanced by previous batches
+  // are instanced again
+  std::unordered_map<const Mesh *, std::uint32_t> instanced_meshes;
+
+  for (std::size_t i = 0; i < m_meshes.size(); ++i) {
+    instanced_meshes.emplace(m_meshes[i].get(),
+                             static_cast<std::uint32_t>(i));
+  }
+
+  // Second pass: output ranges of placements, mesh instances temporarily
+  // keep the number of ranges before them as the index offset
+  std::vector<InstanceRange> ranges;
+  auto vertex_count = m_vertices.size();
+  auto index_count = m_indices.size();
+  const auto first_instance = m_instances.size();
+
+  for (const auto &placement : placements) {
+    const auto &mesh = placement.entity->mesh;
+    auto instanced_mesh = instanced_meshes.find(mesh.get());
+
+    if (instanced_mesh == instanced_meshes.end() &&
+        mesh_placements[mesh.get()] >= min_mesh_instances) {
+
+      instanced_mesh =
+          instanced_meshes
+              .emplace(mesh.get(), static_cast<std::uint32_t>(m_meshes.size()))
+              .first;
+      m_meshes.push_back(mesh);
+    }
+
+    if (instanced_mesh != instanced_meshes.end()) {
+      m_instances.push_back(
+          {instanced_mesh->second, ranges.size(), placement.model_matrix,
+           glm::inverseTranspose(glm::mat3{placement.model_matrix})});
+
+      continue;
+    }
+
+    ranges.push_back(
+        {mesh.get(), placement.model_matrix, vertex_count, index_count, 0});
+
+    vertex_count += mesh->vertices.size();
+    index_count += mesh->indices.size();
+  }
+
+  ASSERT(vertex_count <= std::numeric_limits<unsigned int>::max(), "Geodata",
+         "Too many vertices in map");
+
+  const auto added_vertex_count = vertex_count - m_vertices.size();
+
+  m_vertices.resize(vertex_count);
+  m_indices.resize(index_count);
+
+  // Third pass: instances are written to their own ranges, so they are
+  // transformed independently
+  const auto transform = [this, &ranges](std::atomic<std::size_t> &next) {
+    std::vector<glm::vec3> normals;
+
+    for (auto i = next++; i < ranges.size(); i = next++) {
+      auto &range = ranges[i];
+      range.kept_index_count = transform_mesh(
+          *range.mesh, range.model_matrix,
+          glm::inverseTranspose(glm::mat3{range.model_matrix}),
+          &m_bounding_box, &m_vertices[range.vertex_offset],
+          &m_indices[range.index_offset],
+          static_cast<unsigned int>(range.vertex_offset), normals);
+    }
+  };
+
+  std::atomic<std::size_t> next{0};
+  std::vector<std::future<void>> tasks;
+
+  if (thread_pool != nullptr && added_vertex_count >= parallel_vertex_count) {
+    const auto task_count =
+        std::min(thread_pool->thread_count(), ranges.size());
+
+    for (std::size_t i = 1; i < task_count; ++i) {
+      tasks.push_back(
+          thread_pool->submit([&transform, &next] { transform(next); }));
+    }
+  }
+
+  transform(next);
+
+  for (auto &task : tasks) {
+    task.get();
+  }
+
+  // Close gaps left by culled triangles, ranges only move towards the start
+  auto kept_index_count = ranges.empty() ? index_count
+                                         : ranges.front().index_offset;
+
+  for (auto &range : ranges) {
+    if (range.index_offset != kept_index_count) {
+      std::copy_n(m_indices.begin() + range.index_offset,
+                  range.kept_index_count,
+                  m_indices.begin() + kept_index_count);
+    }
+
+    range.index_offset = kept_index_count;
+    kept_index_count += range.kept_index_count;
+  }
+
+  for (auto i = first_instance; i < m_instances.size(); ++i) {
+    auto &instance = m_instances[i];
+    instance.index_offset = instance.index_offset < ranges.size()
+                                ? ranges[instance.index_offset].index_offset
+                                : kept_index_count;
+  }
+
+  utils::Log(utils::LOG_DEBUG, "Geodata")
+      << "Culled " << culled_instances << " entity instances and "
+      << (index_count - kept_index_count) / 3
+      << " triangles outside of the map, instanced "
+      << m_instances.size() - first_instance << " placements, "
+      << m_meshes.size() << " meshes are instanced" << std::endl;
+
+  m_indices.resize(kept_index_count);
+}
+
+void Map::instance_geometry(const MeshInstance &instance,
+                            std::vector<glm::vec3> &vertices,
+                            std::vector<unsigned int> &indices) const {
+
+  const auto &mesh = *m_meshes[instance.mesh];
+
+  vertices.resize(mesh.vertices.size());
+  indices.resize(mesh.indices.size());
+
+  std::vector<glm::vec3> normals;
+  transform_mesh(mesh, instance.model_matrix, instance.normal_matrix, nullptr,
+                 vertices.data(), indices.data(), 0, normals);
+}
+
+auto Map::instance_triangle(const MeshInstance &instance,
+                            std::size_t triangle) const
+    -> std::array<glm::vec3, 3> {
+
+  const auto &mesh = *m_meshes[instance.mesh];
+  const auto *indices = &mesh.indices[triangle * 3];
+
+  const AffineTransform transform{instance.model_matrix};
+
+  std::array<glm::vec3, 3> vertices{};
+  std::array<glm::vec3, 3> normals{};
+
+  for (auto i = 0; i < 3; ++i) {
+    const auto &vertex = mesh.vertices[indices[i]];
+    vertices[i] = transform.apply(vertex.position);
+    normals[i] = transform_normal(instance.normal_matrix, vertex.normal);
+  }
+
+  if (reverse_winding(normals, vertices)) {
+    std::swap(vertices[0], vertices[2]);
+  }
+
+  return vertices;
+}
+
+void Map::add(const Terrain &terrain) {
+  ASSERT(!m_terrain.has_value(), "Geodata", "Map can have only one terrain");
+  ASSERT(terrain.width > 1 && terrain.height > 1, "Geodata",
+         "Terrain must have at least one quad");
+  ASSERT(terrain.scale.x > 0.0f && terrain.scale.y > 0.0f, "Geodata",
+         "Terrain must have positive scale");
+
+  const auto vertex_count =
+      static_cast<std::size_t>(terrain.width) * terrain.height;
+  const auto quad_count =
+      static_cast<std::size_t>(terrain.width - 1) * (terrain.height - 1);
+
+  ASSERT(terrain.heights.size() == vertex_count &&
+             terrain.quads.size() == quad_count,
+         "Geodata", "Terrain heightmap doesn't match its size");
+
+  m_terrain = terrain;
 }
 
 auto Map::name() const -> const std::string & { return m_name; }
@@ -93,4 +416,16 @@ auto Map::indices() const -> const std::vector<unsigned int> & {
   return m_indices;
 }
 
+auto Map::meshes() const -> const std::vector<std::shared_ptr<const Mesh>> & {
+  return m_meshes;
+}
+
+auto Map::instances() const -> const std::vector<MeshInstance> & {
+  return m_instances;
+}
+
+auto Map::terrain() const -> const std::optional<Terrain> & {
+  return m_terrain;
+}
+
 } // namespace geodata
@@ -0,0 +1,350 @@
+#include "pch.h"
+
+#include <geodata/MapCache.h>
+
+namespace geodata {
+
+namespace {
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+static_assert(sizeof(glm::vec2) == 2 * sizeof(float));
+static_assert(sizeof(unsigned int) == sizeof(std::uint32_t));
+
+template <typename T> void write(std::ostream &output, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> auto read(std::istream &input) -> T {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value{};
+  input.read(reinterpret_cast<char *>(&value), sizeof(value));
+  return value;
+}
+
+template <typename T>
+void write_vector(std::ostream &output, const std::vector<T> &vector) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  write(output, static_cast<std::uint64_t>(vector.size()));
+  output.write(reinterpret_cast<const char *>(vector.data()),
+               static_cast<std::streamsize>(vector.size() * sizeof(T)));
+}
+
+// Arrays are stored as is, so they are read with a single call
+template <typename T>
+void read_vector(std::istream &input, std::uint64_t input_size,
+                 std::vector<T> &vector) {
+
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  const auto count = read<std::uint64_t>(input);
+
+  if (!utils::fits(input, input_size, count, sizeof(T))) {
+    return;
+  }
+
+  vector.resize(count);
+  input.read(reinterpret_cast<char *>(vector.data()),
+             static_cast<std::streamsize>(vector.size() * sizeof(T)));
+}
+
+void write_string(std::ostream &output, std::string_view string) {
+  write(output, static_cast<std::uint32_t>(string.size()));
+  output.write(string.data(), static_cast<std::streamsize>(string.size()));
+}
+
+auto read_string(std::istream &input, std::uint64_t input_size)
+    -> std::string {
+
+  const auto size = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, size, 1)) {
+    return {};
+  }
+
+  std::string string(size, '\0');
+  input.read(string.data(), static_cast<std::streamsize>(string.size()));
+  return string;
+}
+
+void write_sources(std::ostream &output, const MapCache::Sources &sources) {
+  write(output, sources.loader_version);
+  write_string(output, sources.loader_options);
+  write(output, static_cast<std::uint32_t>(sources.files.size()));
+
+  for (const auto &file : sources.files) {
+    write_string(output, file.name);
+    write(output, file.size);
+    write(output, file.modified);
+  }
+}
+
+auto read_sources(std::istream &input, std::uint64_t input_size)
+    -> MapCache::Sources {
+
+  MapCache::Sources sources{};
+  sources.loader_version = read<std::uint32_t>(input);
+  sources.loader_options = read_string(input, input_size);
+
+  const auto file_count = read<std::uint32_t>(input);
+
+  for (std::uint32_t i = 0; i < file_count && input; ++i) {
+    MapCache::SourceFile file{};
+    file.name = read_string(input, input_size);
+    file.size = read<std::uint64_t>(input);
+    file.modified = read<std::int64_t>(input);
+    sources.files.push_back(std::move(file));
+  }
+
+  return sources;
+}
+
+// Instances are written field by field, so the padding of MeshInstance
+// doesn't get into the file
+void write_instances(std::ostream &output,
+                     const std::vector<MeshInstance> &instances) {
+
+  write(output, static_cast<std::uint64_t>(instances.size()));
+
+  for (const auto &instance : instances) {
+    write(output, instance.mesh);
+    write(output, instance.index_offset);
+    write(output, instance.model_matrix);
+    write(output, instance.normal_matrix);
+  }
+}
+
+void read_instances(std::istream &input, std::uint64_t input_size,
+                    std::vector<MeshInstance> &instances) {
+
+  constexpr auto instance_size = sizeof(std::uint32_t) +
+                                 sizeof(std::uint64_t) + sizeof(glm::mat4) +
+                                 sizeof(glm::mat3);
+
+  const auto count = read<std::uint64_t>(input);
+
+  if (!utils::fits(input, input_size, count, instance_size)) {
+    return;
+  }
+
+  instances.resize(count);
+
+  for (auto &instance : instances) {
+    instance.mesh = read<std::uint32_t>(input);
+    instance.index_offset = read<std::uint64_t>(input);
+    instance.model_matrix = read<glm::mat4>(input);
+    instance.normal_matrix = read<glm::mat3>(input);
+  }
+}
+
+auto has_valid_indices(const std::vector<unsigned int> &indices,
+                       std::size_t vertex_count) -> bool {
+
+  return indices.size() % 3 == 0 &&
+         std::all_of(indices.begin(), indices.end(),
+                     [vertex_count](unsigned int index) {
+                       return index < vertex_count;
+                     });
+}
+
+// Contents are trusted by NSWE and the terrain rasterizer, so everything they
+// index with is checked, the same as when the map is built
+auto is_consistent(const Map &map) -> bool {
+  if (!has_valid_indices(map.indices(), map.vertices().size())) {
+    return false;
+  }
+
+  for (const auto &mesh : map.meshes()) {
+    if (!has_valid_indices(mesh->indices, mesh->vertices.size())) {
+      return false;
+    }
+  }
+
+  // Instances are rasterized in between map triangles in their order
+  std::uint64_t index_offset = 0;
+
+  for (const auto &instance : map.instances()) {
+    if (instance.mesh >= map.meshes().size() ||
+        instance.index_offset < index_offset ||
+        instance.index_offset > map.indices().size() ||
+        instance.index_offset % 3 != 0) {
+
+      return false;
+    }
+
+    index_offset = instance.index_offset;
+  }
+
+  const auto &terrain = map.terrain();
+
+  if (!terrain.has_value()) {
+    return true;
+  }
+
+  if (terrain->width < 2 || terrain->height < 2 || !(terrain->scale.x > 0.0f) ||
+      !(terrain->scale.y > 0.0f)) {
+
+    return false;
+  }
+
+  const auto vertex_count =
+      static_cast<std::size_t>(terrain->width) * terrain->height;
+  const auto quad_count =
+      static_cast<std::size_t>(terrain->width - 1) * (terrain->height - 1);
+
+  return terrain->heights.size() == vertex_count &&
+         terrain->quads.size() == quad_count;
+}
+
+} // namespace
+
+MapCache::MapCache(const std::filesystem::path &directory)
+    : m_directory{directory} {
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+
+  if (error) {
+    utils::Log(utils::LOG_WARN, "Geodata")
+        << "Can't create map cache directory: " << m_directory << std::endl;
+  }
+}
+
+auto MapCache::entry_path(const std::string &name) const
+    -> std::filesystem::path {
+
+  return m_directory / (name + ".map");
+}
+
+auto MapCache::load(
+    const std::string &name,
+    const std::function<bool(const Sources &sources)> &is_fresh) const
+    -> std::optional<Entry> {
+
+  const auto path = entry_path(name);
+
+  std::error_code error;
+  const auto input_size = std::filesystem::file_size(path, error);
+  std::ifstream input{path, std::ios::binary};
+
+  if (error || !input) {
+    return {};
+  }
+
+  if (read<std::uint32_t>(input) != CACHE_MAGIC ||
+      read<std::uint32_t>(input) != CACHE_VERSION ||
+      read_string(input, input_size) != name || !input) {
+
+    return {};
+  }
+
+  // Sources are checked before the geometry is read
+  auto sources = read_sources(input, input_size);
+
+  if (!input || !is_fresh(sources)) {
+    return {};
+  }
+
+  const auto min = read<glm::vec3>(input);
+  const auto max = read<glm::vec3>(input);
+
+  Map map{name, geometry::Box{min, max}};
+  read_vector(input, input_size, map.m_vertices);
+  read_vector(input, input_size, map.m_indices);
+
+  const auto mesh_count = read<std::uint64_t>(input);
+
+  for (std::uint64_t i = 0; i < mesh_count && input; ++i) {
+    const auto mesh = std::make_shared<Mesh>();
+    read_vector(input, input_size, mesh->vertices);
+    read_vector(input, input_size, mesh->indices);
+    map.m_meshes.push_back(mesh);
+  }
+
+  read_instances(input, input_size, map.m_instances);
+
+  if (read<std::uint8_t>(input) != 0) {
+    Terrain terrain{};
+    terrain.origin = read<glm::vec2>(input);
+    terrain.scale = read<glm::vec2>(input);
+    terrain.width = read<std::int32_t>(input);
+    terrain.height = read<std::int32_t>(input);
+    read_vector(input, input_size, terrain.heights);
+    read_vector(input, input_size, terrain.quads);
+    map.m_terrain = std::move(terrain);
+  }
+
+  if (!input || !is_consistent(map)) {
+    utils::Log(utils::LOG_WARN, "Geodata")
+        << "Corrupted map cache entry: " << entry_path(name) << std::endl;
+    return {};
+  }
+
+  return Entry{std::move(map), std::move(sources)};
+}
+
+void MapCache::store(const Map &map, const Sources &sources) const {
+  const auto path = entry_path(map.name());
+
+  // Write to a temporary file and rename it, so readers never see partially
+  // written entries
+  auto temporary_path = path;
+  temporary_path += ".tmp";
+
+  std::error_code error;
+
+  {
+    std::ofstream output{temporary_path, std::ios::binary};
+
+    const auto bounding_box = map.bounding_box();
+
+    write(output, CACHE_MAGIC);
+    write(output, CACHE_VERSION);
+    write_string(output, map.name());
+    write_sources(output, sources);
+    write(output, bounding_box.min());
+    write(output, bounding_box.max());
+    write_vector(output, map.vertices());
+    write_vector(output, map.indices());
+
+    write(output, static_cast<std::uint64_t>(map.meshes().size()));
+
+    for (const auto &mesh : map.meshes()) {
+      write_vector(output, mesh->vertices);
+      write_vector(output, mesh->indices);
+    }
+
+    write_instances(output, map.instances());
+
+    const auto &terrain = map.terrain();
+    write(output, static_cast<std::uint8_t>(terrain.has_value()));
+
+    if (terrain.has_value()) {
+      write(output, terrain->origin);
+      write(output, terrain->scale);
+      write(output, static_cast<std::int32_t>(terrain->width));
+      write(output, static_cast<std::int32_t>(terrain->height));
+      write_vector(output, terrain->heights);
+      write_vector(output, terrain->quads);
+    }
+
+    output.close();
+
+    if (!output) {
+      utils::Log(utils::LOG_WARN, "Geodata")
+          << "Can't write map cache entry: " << path << std::endl;
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary_path, path, error);
+
+  if (error) {
+    utils::Log(utils::LOG_WARN, "Geodata")
+        << "Can't write map cache entry: " << path << std::endl;
+    std::filesystem::remove(temporary_path, error);
+  }
+}
+
+} // namespace geodata
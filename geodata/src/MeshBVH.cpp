@@ -0,0 +1,87 @@
+#include "pch.h"
+
+#include "MeshBVH.h"
+
+namespace geodata {
+
+namespace {
+
+constexpr std::uint32_t max_leaf_triangles = 4;
+
+} // namespace
+
+MeshBVH::MeshBVH(const Mesh &mesh) {
+  const auto triangle_count = mesh.indices.size() / 3;
+
+  if (triangle_count == 0) {
+    return;
+  }
+
+  m_triangles.reserve(triangle_count);
+
+  for (std::size_t i = 0; i < triangle_count; ++i) {
+    const auto &a = mesh.vertices[mesh.indices[i * 3 + 0]].position;
+    const auto &b = mesh.vertices[mesh.indices[i * 3 + 1]].position;
+    const auto &c = mesh.vertices[mesh.indices[i * 3 + 2]].position;
+
+    m_triangles.push_back({glm::min(glm::min(a, b), c),
+                           glm::max(glm::max(a, b), c),
+                           static_cast<std::uint32_t>(i)});
+  }
+
+  m_nodes.reserve(2 * (triangle_count / max_leaf_triangles + 1));
+  build(0, static_cast<std::uint32_t>(triangle_count));
+}
+
+auto MeshBVH::empty() const -> bool { return m_nodes.empty(); }
+
+auto MeshBVH::min() const -> const glm::vec3 & { return m_nodes.front().min; }
+auto MeshBVH::max() const -> const glm::vec3 & { return m_nodes.front().max; }
+
+void MeshBVH::build(std::uint32_t first, std::uint32_t count) {
+  const auto begin = m_triangles.begin() + first;
+  const auto end = begin + count;
+
+  auto min = begin->min;
+  auto max = begin->max;
+  auto center_min = (begin->min + begin->max) * 0.5f;
+  auto center_max = center_min;
+
+  for (auto triangle = begin; triangle != end; ++triangle) {
+    const auto center = (triangle->min + triangle->max) * 0.5f;
+    min = glm::min(min, triangle->min);
+    max = glm::max(max, triangle->max);
+    center_min = glm::min(center_min, center);
+    center_max = glm::max(center_max, center);
+  }
+
+  const auto node = m_nodes.size();
+  m_nodes.push_back({min, max, first, count});
+
+  if (count <= max_leaf_triangles) {
+    return;
+  }
+
+  // Median of triangle centers along the longest axis
+  const auto extent = center_max - center_min;
+  const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0
+                    : extent.y >= extent.z                      ? 1
+                                                                : 2;
+
+  const auto half = count / 2;
+
+  std::nth_element(begin, begin + half, end,
+                   [axis](const Triangle &a, const Triangle &b) {
+                     return a.min[axis] + a.max[axis] <
+                            b.min[axis] + b.max[axis];
+                   });
+
+  build(first, half);
+
+  m_nodes[node].offset = static_cast<std::uint32_t>(m_nodes.size());
+  m_nodes[node].triangle_count = 0;
+
+  build(first + half, count - half);
+}
+
+} // namespace geodata
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <geodata/Entity.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace geodata {
+
+// Bounding volume hierarchy over mesh triangles in the mesh space. Every
+// instance of the mesh is queried with bounds transformed into the mesh
+// space, so instances are never transformed as a whole for collisions.
+class MeshBVH {
+public:
+  explicit MeshBVH(const Mesh &mesh);
+
+  auto empty() const -> bool;
+
+  // Bounds of all triangles, the mesh must not be empty
+  auto min() const -> const glm::vec3 &;
+  auto max() const -> const glm::vec3 &;
+
+  // Calls the function with indices of triangles whose bounds overlap the
+  // box, stops as soon as the function returns true. Returns whether it was
+  // stopped.
+  template <typename F>
+  auto query(const glm::vec3 &min, const glm::vec3 &max, F function) const
+      -> bool {
+
+    if (m_nodes.empty()) {
+      return false;
+    }
+
+    // Median splits keep the depth logarithmic
+    std::array<std::uint32_t, 64> stack{};
+    std::size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+      const auto index = stack[--stack_size];
+      const auto &node = m_nodes[index];
+
+      if (!overlaps(node.min, node.max, min, max)) {
+        continue;
+      }
+
+      if (node.triangle_count == 0) {
+        stack[stack_size++] = node.offset;
+        stack[stack_size++] = index + 1;
+        continue;
+      }
+
+      for (auto i = node.offset; i < node.offset + node.triangle_count; ++i) {
+        const auto &triangle = m_triangles[i];
+
+        if (overlaps(triangle.min, triangle.max, min, max) &&
+            function(triangle.index)) {
+
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+private:
+  // Leaves have triangles, the first child of other nodes follows them and
+  // the offset points to the second one
+  struct Node {
+    glm::vec3 min;
+    glm::vec3 max;
+    std::uint32_t offset;
+    std::uint32_t triangle_count;
+  };
+
+  struct Triangle {
+    glm::vec3 min;
+    glm::vec3 max;
+    std::uint32_t index;
+  };
+
+  std::vector<Node> m_nodes;
+
+  // Ordered by leaves
+  std::vector<Triangle> m_triangles;
+
+  static auto overlaps(const glm::vec3 &a_min, const glm::vec3 &a_max,
+                       const glm::vec3 &b_min, const glm::vec3 &b_max)
+      -> bool {
+
+    return a_min.x <= b_max.x && a_max.x >= b_min.x && a_min.y <= b_max.y &&
+           a_max.y >= b_min.y && a_min.z <= b_max.z && a_max.z >= b_min.z;
+  }
+
+  void build(std::uint32_t first, std::uint32_t count);
+};
+
+} // namespace geodata
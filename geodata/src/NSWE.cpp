@@ -31,6 +31,18 @@ inline auto direction_forbidden(int area, int direction) -> bool {
   return (area >> 2 & (1 << direction)) == 0;
 }
 
+// Bounds of mesh instances and queries in the mesh space are inflated, so
+// rounding of transformations never loses a triangle
+constexpr auto instance_margin = 1.0f;
+
+inline auto boxes_overlap(const glm::vec3 &a_min, const glm::vec3 &a_max,
+                          const glm::vec3 &b_min, const glm::vec3 &b_max)
+    -> bool {
+
+  return a_min.x <= b_max.x && a_max.x >= b_min.x && a_min.y <= b_max.y &&
+         a_max.y >= b_min.y && a_min.z <= b_max.z && a_max.z >= b_min.z;
+}
+
 inline auto vertical_slope(const glm::vec3 &vector) -> float {
   // TODO: Vector can be already normalized
   return glm::dot(glm::normalize(vector), {0.0f, 1.0f, 0.0f});
@@ -53,7 +65,17 @@ NSWE::NSWE(const Map &map, float actor_height, float actor_radius,
       m_max_walkable_angle_radians{std::cos(glm::radians(max_walkable_angle))},
       m_min_walkable_climb{min_walkable_climb},
       m_max_walkable_climb{max_walkable_climb}, m_cell_size{cell_size},
-      m_cell_height{cell_height}, m_hf{rcAllocHeightfield()} {
+      m_cell_height{cell_height},
+      m_terrain_rasterizer{map.terrain().has_value()
+                               ? std::make_optional<TerrainRasterizer>(
+                                     *map.terrain(),
+                                     m_max_walkable_angle_radians)
+                               : std::nullopt},
+      m_terrain_collider{map.terrain().has_value()
+                             ? std::make_optional<TerrainCollider>(
+                                   *map.terrain())
+                             : std::nullopt},
+      m_hf{rcAllocHeightfield()}, m_instances_column{-1} {
 
   utils::Log(utils::LOG_INFO, "Geodata")
       << "Building intial heightfield" << std::endl;
@@ -90,27 +112,199 @@ void NSWE::build_filtered_heightfield() {
   rcCreateHeightfield(&context, *m_hf, width, height, bb_min, bb_max,
                       m_cell_size, m_cell_height);
 
-  // Prepare geometry data
-  const auto *vertices = glm::value_ptr(m_map.vertices().front());
+  // Prepare geometry data, maps can have only terrain
+  const auto *vertices =
+      reinterpret_cast<const float *>(m_map.vertices().data());
   const auto vertex_count = m_map.vertices().size();
   const auto *triangles = reinterpret_cast<const int *>(m_map.indices().data());
   const auto triangle_count = m_map.indices().size() / 3;
 
+  // Rasterize terrain heightmap before meshes, span areas are merged in the
+  // rasterization order
+  if (m_terrain_rasterizer.has_value()) {
+    m_terrain_rasterizer->rasterize(*m_hf);
+  }
+
   // Rasterize triangles
   fill_vector(m_triangle_index, width * height);
   fill_vector(m_triangle_cache, width * height);
 
+  // Mesh instances collide through hierarchies of their meshes
+  for (const auto &mesh : m_map.meshes()) {
+    m_mesh_bvhs.emplace_back(*mesh);
+  }
+
+  m_instance_triangles.resize(m_map.instances().size());
+
+  // Mesh instances are transformed one by one and rasterized in between map
+  // triangles in the order they were added, spans are merged the same way
+  std::vector<glm::vec3> instance_vertices;
+  std::vector<unsigned int> instance_indices;
+
+  std::size_t rasterized_triangles = 0;
+
+  for (std::uint32_t i = 0; i < m_map.instances().size(); ++i) {
+    const auto &instance = m_map.instances()[i];
+    const auto instance_offset = instance.index_offset / 3;
+
+    rasterize_triangles(context, vertices, vertex_count,
+                        &triangles[rasterized_triangles * 3],
+                        instance_offset - rasterized_triangles,
+                        static_cast<int>(rasterized_triangles));
+    rasterized_triangles = instance_offset;
+
+    const auto &bvh = m_mesh_bvhs[instance.mesh];
+    const glm::vec3 margin{instance_margin};
+
+    m_instance_bounds.push_back(
+        bvh.empty() ? geometry::Box{}
+                    : geometry::Box{bvh.min() - margin, bvh.max() + margin,
+                                    instance.model_matrix});
+    m_instance_inverses.push_back(glm::inverse(instance.model_matrix));
+
+    m_map.instance_geometry(instance, instance_vertices, instance_indices);
+    rasterize_instance(context, i, instance_vertices, instance_indices);
+  }
+
+  rasterize_triangles(context, vertices, vertex_count,
+                      &triangles[rasterized_triangles * 3],
+                      triangle_count - rasterized_triangles,
+                      static_cast<int>(rasterized_triangles));
+
+  // Remember areas to be able to reset the heightfield
+  for (auto i = 0; i < m_hf->width * m_hf->height; ++i) {
+    for (const auto *span = m_hf->spans[i]; span != nullptr;
+         span = span->next) {
+
+      m_rasterized_areas.push_back(static_cast<unsigned char>(span->area));
+    }
+  }
+
+  filter_low_height_spans();
+}
+
+void NSWE::rasterize_triangles(rcContext &context, const float *vertices,
+                               std::size_t vertex_count, const int *triangles,
+                               std::size_t triangle_count, int first_triangle) {
+
+  rasterize_indexed(
+      context, vertices, vertex_count, triangles, triangle_count,
+      [first_triangle](std::vector<int> &indices, std::size_t column_size) {
+        for (auto i = column_size; i < indices.size(); ++i) {
+          indices[i] += first_triangle;
+        }
+      });
+}
+
+void NSWE::rasterize_instance(rcContext &context, std::uint32_t instance,
+                              const std::vector<glm::vec3> &vertices,
+                              const std::vector<unsigned int> &indices) {
+
+  // Triangles of the instance are replaced with the instance itself, they are
+  // found through the hierarchy of the mesh
+  rasterize_indexed(
+      context, reinterpret_cast<const float *>(vertices.data()),
+      vertices.size(), reinterpret_cast<const int *>(indices.data()),
+      indices.size() / 3,
+      [instance](std::vector<int> &column_indices, std::size_t column_size) {
+        if (column_indices.size() > column_size) {
+          column_indices.resize(column_size);
+          column_indices.push_back(-1 - static_cast<int>(instance));
+        }
+      });
+}
+
+template <typename F>
+void NSWE::rasterize_indexed(rcContext &context, const float *vertices,
+                             std::size_t vertex_count, const int *triangles,
+                             std::size_t triangle_count, F update_column) {
+
+  if (triangle_count == 0) {
+    return;
+  }
+
   std::vector<unsigned char> areas(triangle_count);
   mark_walkable_triangles(vertices, triangles, triangle_count, &areas.front());
+
+  // Only columns under the triangles can get new indices
+  auto min = glm::make_vec3(&vertices[triangles[0] * 3]);
+  auto max = min;
+
+  for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+    const auto vertex = glm::make_vec3(&vertices[triangles[i] * 3]);
+    min = glm::min(min, vertex);
+    max = glm::max(max, vertex);
+  }
+
+  // One more column on every side, Recast clips triangles partly outside of
+  // the heightfield into its border columns
+  const auto column = [this](float position, float origin, int size) {
+    const auto cell = std::floor((position - origin) / m_hf->cs);
+    return static_cast<int>(
+        std::clamp(cell, 0.0f, static_cast<float>(size - 1)));
+  };
+
+  const auto min_x = std::max(column(min.x, m_hf->bmin[0], m_hf->width) - 1, 0);
+  const auto max_x =
+      std::min(column(max.x, m_hf->bmin[0], m_hf->width) + 1, m_hf->width - 1);
+  const auto min_y =
+      std::max(column(min.z, m_hf->bmin[2], m_hf->height) - 1, 0);
+  const auto max_y = std::min(column(max.z, m_hf->bmin[2], m_hf->height) + 1,
+                              m_hf->height - 1);
+
+  std::vector<std::size_t> column_sizes;
+
+  for (auto y = min_y; y <= max_y; ++y) {
+    for (auto x = min_x; x <= max_x; ++x) {
+      column_sizes.push_back(m_triangle_index[x + y * m_hf->width].size());
+    }
+  }
+
   rcRasterizeTriangles(&context, vertices, vertex_count, triangles,
                        &areas.front(), triangle_count, *m_hf,
                        &m_triangle_index.front());
 
-  // Filter too short spans
+  auto column_size = column_sizes.cbegin();
+
+  for (auto y = min_y; y <= max_y; ++y) {
+    for (auto x = min_x; x <= max_x; ++x) {
+      update_column(m_triangle_index[x + y * m_hf->width], *column_size++);
+    }
+  }
+}
+
+void NSWE::filter_low_height_spans() {
+  rcContext context{};
   rcFilterWalkableLowHeightSpans(
       &context, static_cast<int>(m_actor_height / m_cell_height), *m_hf);
 }
 
+void NSWE::reset(float actor_height, float actor_radius,
+                 float min_walkable_climb, float max_walkable_climb) {
+
+  m_actor_height = actor_height;
+  m_actor_radius = actor_radius;
+  m_min_walkable_climb = min_walkable_climb;
+  m_max_walkable_climb = max_walkable_climb;
+
+  auto area = m_rasterized_areas.cbegin();
+
+  for (auto i = 0; i < m_hf->width * m_hf->height; ++i) {
+    for (auto *span = m_hf->spans[i]; span != nullptr; span = span->next) {
+      span->area = *area++;
+    }
+  }
+
+  // Cached triangles depend on the actor radius
+  for (auto &triangles : m_triangle_cache) {
+    triangles.clear();
+  }
+
+  m_instances_column = -1;
+
+  filter_low_height_spans();
+}
+
 void NSWE::mark_walkable_triangles(const float *vertices, const int *triangles,
                                    std::size_t triangle_count,
                                    unsigned char *areas) const {
@@ -276,7 +470,7 @@ auto NSWE::slide_sphere_until_collision(int x, int y, int z,
 
   static constexpr auto delta = 1.0f;
 
-  static const auto triangles_fetch_radius =
+  const auto triangles_fetch_radius =
       static_cast<int>(std::ceil(m_actor_radius * 2.0f / m_cell_size));
 
   const auto map_origin = m_map.bounding_box().min();
@@ -295,10 +489,15 @@ auto NSWE::slide_sphere_until_collision(int x, int y, int z,
 
   geometry::Sphere sphere{sphere_center, sphere_radius};
 
+  const auto is_obstacle = [](const geometry::Intersection &intersection) {
+    return vertical_slope(intersection.normal * intersection.depth) < 0.3f;
+  };
+
   const auto triangles = triangles_at_columns(x, y, triangles_fetch_radius);
+  const auto &instances = instances_at_columns(x, y, triangles_fetch_radius);
 
   for (auto i = 0; i < static_cast<int>(m_cell_size * 1.5f / delta); ++i) {
-    drop_sphere(sphere, triangles);
+    drop_sphere(sphere, triangles, instances);
 
     sphere.center.x += dx * delta;
     sphere.center.z += dy * delta;
@@ -306,16 +505,23 @@ auto NSWE::slide_sphere_until_collision(int x, int y, int z,
     for (const auto &triangle : triangles) {
       geometry::Intersection intersection{};
 
-      if (sphere.intersects(triangle, intersection)) {
-        const auto slope =
-            vertical_slope(intersection.normal * intersection.depth);
+      if (sphere.intersects(triangle, intersection) &&
+          is_obstacle(intersection)) {
 
-        if (slope < 0.3f) {
-          return true;
-        }
+        return true;
       }
     }
 
+    if (intersects_instances(sphere, instances, is_obstacle)) {
+      return true;
+    }
+
+    if (m_terrain_collider.has_value() &&
+        m_terrain_collider->intersects(sphere, is_obstacle)) {
+
+      return true;
+    }
+
     sphere.center.y += delta;
   }
 
@@ -323,14 +529,27 @@ auto NSWE::slide_sphere_until_collision(int x, int y, int z,
 }
 
 void NSWE::drop_sphere(geometry::Sphere &sphere,
-                       const std::vector<geometry::Triangle> &triangles) const {
+                       const std::vector<geometry::Triangle> &triangles,
+                       const ColumnInstances &instances) const {
 
   static constexpr auto delta = 1.0f;
 
   const auto original_z = sphere.center.y;
 
+  // Sphere touches the terrain once it's dropped to this height, so the
+  // terrain isn't intersected step by step
+  const auto terrain_z = m_terrain_collider.has_value()
+                             ? m_terrain_collider->drop_height(sphere)
+                             : std::nullopt;
+
   while (original_z - sphere.center.y < m_max_walkable_climb * 2.0f) {
-    if (sphere.intersects(triangles)) {
+    if ((terrain_z.has_value() && sphere.center.y <= *terrain_z) ||
+        sphere.intersects(triangles) ||
+        intersects_instances(sphere, instances,
+                             [](const geometry::Intersection &) {
+                               return true;
+                             })) {
+
       if (sphere.center.y != original_z) {
         sphere.center.y += delta;
       }
@@ -365,45 +584,199 @@ auto NSWE::triangles_at_columns(int x, int y, int radius) const
       }
     }
 
-    // Make triangles by found indices
+    // Make triangles by found indices, mesh instances are skipped
     for (const auto index : column_indices) {
-      const geometry::Triangle triangle{
-          map_vertices[map_triangles[index * 3 + 0]],
-          map_vertices[map_triangles[index * 3 + 1]],
-          map_vertices[map_triangles[index * 3 + 2]],
-      };
+      if (index < 0) {
+        continue;
+      }
 
-      triangles.push_back(triangle);
+      triangles.emplace_back(map_vertices[map_triangles[index * 3 + 0]],
+                             map_vertices[map_triangles[index * 3 + 1]],
+                             map_vertices[map_triangles[index * 3 + 2]]);
     }
   }
 
   return triangles;
 }
 
-void NSWE::print_progress(int x, int y) const {
-  if (utils::Log::level < utils::LOG_INFO) {
-    return;
+auto NSWE::instances_at_columns(int x, int y, int radius) const
+    -> const ColumnInstances & {
+
+  const auto column = x + y * m_hf->width;
+
+  if (column == m_instances_column) {
+    return m_column_instances;
   }
 
-  const auto current = (x + 1) + (y + 1) * m_hf->width;
-  const auto total = m_hf->height * m_hf->width;
+  m_instances_column = column;
 
-  if (current == total) {
-    std::cout << std::endl;
-    return;
+  const auto min_x = std::max(x - radius, 0);
+  const auto max_x = std::min(x + radius, m_hf->width - 1);
+  const auto min_y = std::max(y - radius, 0);
+  const auto max_y = std::min(y + radius, m_hf->height - 1);
+
+  auto &instances = m_column_instances.instances;
+  instances.clear();
+
+  for (auto dy = min_y; dy <= max_y; ++dy) {
+    for (auto dx = min_x; dx <= max_x; ++dx) {
+      for (const auto index : m_triangle_index[dx + dy * m_hf->width]) {
+        if (index < 0) {
+          instances.push_back(static_cast<std::uint32_t>(-1 - index));
+        }
+      }
+    }
+  }
+
+  std::sort(instances.begin(), instances.end());
+  instances.erase(std::unique(instances.begin(), instances.end()),
+                  instances.end());
+
+  static constexpr auto infinity = std::numeric_limits<float>::infinity();
+
+  m_column_instances.min = {
+      min_x == 0 ? -infinity : m_hf->bmin[0] + min_x * m_hf->cs,
+      min_y == 0 ? -infinity : m_hf->bmin[2] + min_y * m_hf->cs,
+  };
+
+  m_column_instances.max = {
+      max_x == m_hf->width - 1 ? infinity
+                               : m_hf->bmin[0] + (max_x + 1) * m_hf->cs,
+      max_y == m_hf->height - 1 ? infinity
+                                : m_hf->bmin[2] + (max_y + 1) * m_hf->cs,
+  };
+
+  return m_column_instances;
+}
+
+template <typename P>
+auto NSWE::intersects_instances(const geometry::Sphere &sphere,
+                                const ColumnInstances &instances,
+                                P predicate) const -> bool {
+
+  const glm::vec3 radius{sphere.radius};
+  const auto sphere_min = sphere.center - radius;
+  const auto sphere_max = sphere.center + radius;
+
+  const auto hf_min = glm::make_vec3(m_hf->bmin);
+  const auto hf_max = glm::make_vec3(m_hf->bmax);
+
+  // Same triangles as Recast rasterized into the fetched columns
+  const auto rasterized = [&hf_min, &hf_max,
+                           &instances](const geometry::Triangle &triangle) {
+    const auto min = glm::min(glm::min(triangle.a, triangle.b), triangle.c);
+    const auto max = glm::max(glm::max(triangle.a, triangle.b), triangle.c);
+
+    if (!boxes_overlap(min, max, hf_min, hf_max) ||
+        max.x < instances.min.x || min.x > instances.max.x ||
+        max.z < instances.min.y || min.z > instances.max.y) {
+
+      return false;
+    }
+
+    // Separating axes of triangle edges in the XZ plane, degenerate edges
+    // never separate
+    const std::array<glm::vec2, 3> points{
+        glm::vec2{triangle.a.x, triangle.a.z},
+        glm::vec2{triangle.b.x, triangle.b.z},
+        glm::vec2{triangle.c.x, triangle.c.z},
+    };
+
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      const auto edge = points[(i + 1) % 3] - points[i];
+      const glm::vec2 axis{-edge.y, edge.x};
+
+      const auto triangle_min =
+          std::min({glm::dot(axis, points[0]), glm::dot(axis, points[1]),
+                    glm::dot(axis, points[2])});
+      const auto triangle_max =
+          std::max({glm::dot(axis, points[0]), glm::dot(axis, points[1]),
+                    glm::dot(axis, points[2])});
+
+      // Nearest and farthest corners of the columns along the axis
+      const glm::vec2 near{axis.x >= 0.0f ? instances.min.x : instances.max.x,
+                           axis.y >= 0.0f ? instances.min.y : instances.max.y};
+      const glm::vec2 far{axis.x >= 0.0f ? instances.max.x : instances.min.x,
+                          axis.y >= 0.0f ? instances.max.y : instances.min.y};
+
+      if (triangle_max < glm::dot(axis, near) ||
+          triangle_min > glm::dot(axis, far)) {
+
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  for (const auto i : instances.instances) {
+    const auto &bvh = m_mesh_bvhs[m_map.instances()[i].mesh];
+    const auto &bounds = m_instance_bounds[i];
+
+    if (bvh.empty() ||
+        !boxes_overlap(bounds.min(), bounds.max(), sphere_min, sphere_max)) {
+
+      continue;
+    }
+
+    const glm::vec3 margin{instance_margin};
+    const geometry::Box query{sphere_min - margin, sphere_max + margin,
+                              m_instance_inverses[i]};
+
+    const auto intersects = bvh.query(
+        query.min(), query.max(), [&](std::uint32_t index) {
+          const auto &triangle = instance_triangle(i, index);
+          geometry::Intersection intersection{};
+
+          return rasterized(triangle) &&
+                 sphere.intersects(triangle, intersection) &&
+                 predicate(intersection);
+        });
+
+    if (intersects) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+auto NSWE::instance_triangle(std::uint32_t instance,
+                             std::uint32_t triangle) const
+    -> const geometry::Triangle & {
+
+  auto &triangles = m_instance_triangles[instance];
+  auto cached = triangles.find(triangle);
+
+  if (cached == triangles.end()) {
+    const auto vertices =
+        m_map.instance_triangle(m_map.instances()[instance], triangle);
+    cached = triangles.try_emplace(triangle, vertices[0], vertices[1],
+                                   vertices[2])
+                 .first;
   }
 
-  const auto part = total / 100;
+  return cached->second;
+}
 
-  if (part == 0) {
+void NSWE::print_progress(int x, int y) const {
+  if (utils::Log::level < utils::LOG_INFO) {
     return;
   }
 
-  if (current % part != 0) {
+  const auto current = (x + 1) + y * m_hf->width;
+  const auto total = m_hf->height * m_hf->width;
+  const auto part = total / 10;
+
+  if (part == 0 || current % part != 0) {
     return;
   }
 
-  std::cout << ".";
+  // Whole lines through the log, so progress of maps built concurrently
+  // doesn't interleave
+  utils::Log(utils::LOG_INFO, "Geodata")
+      << "Map " << m_map.name() << ": " << std::min(current / part, 10) * 10
+      << "%" << std::endl;
 }
 
 } // namespace geodata
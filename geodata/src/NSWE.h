@@ -1,13 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include <geodata/Map.h>
+#include <geometry/Box.h>
 #include <geometry/Sphere.h>
 #include <geometry/Triangle.h>
 
+#include "MeshBVH.h"
 #include "Recast.h"
+#include "TerrainCollider.h"
+#include "TerrainRasterizer.h"
 
 namespace geodata {
 
@@ -29,24 +36,83 @@ public:
 
   auto calculate_nswe() -> const rcHeightfield &;
 
+  // Restores the heightfield to the rasterized state and applies other actor
+  // settings, so NSWE can be calculated again without rasterization. Walkable
+  // angle and cell sizes are baked into the rasterized heightfield.
+  void reset(float actor_height, float actor_radius, float min_walkable_climb,
+             float max_walkable_climb);
+
 private:
   const Map &m_map;
 
-  const float m_actor_height;
-  const float m_actor_radius;
+  float m_actor_height;
+  float m_actor_radius;
   const float m_max_walkable_angle_radians;
-  const float m_min_walkable_climb;
-  const float m_max_walkable_climb;
+  float m_min_walkable_climb;
+  float m_max_walkable_climb;
   const float m_cell_size;
   const float m_cell_height;
 
+  const std::optional<TerrainRasterizer> m_terrain_rasterizer;
+  const std::optional<TerrainCollider> m_terrain_collider;
+
   rcHeightfield *m_hf;
+
+  // Map triangles are indexed as is, mesh instances once per column as
+  // -1 - instance
   std::vector<std::vector<int>> m_triangle_index;
 
+  // Span areas right after rasterization, in column order
+  std::vector<unsigned char> m_rasterized_areas;
+
+  // Map triangles only, terrain is handled by the terrain collider and mesh
+  // instances keep their own triangles
   mutable std::vector<std::vector<geometry::Triangle>> m_triangle_cache;
 
+  // Mesh space hierarchies of instanced meshes
+  std::vector<MeshBVH> m_mesh_bvhs;
+
+  // Map space bounds of mesh instances and their inverse model matrices
+  std::vector<geometry::Box> m_instance_bounds;
+  std::vector<glm::mat4> m_instance_inverses;
+
+  // Triangles of mesh instances transformed on demand, only triangles the
+  // spheres got close to are kept
+  mutable std::vector<std::unordered_map<std::uint32_t, geometry::Triangle>>
+      m_instance_triangles;
+
+  // Mesh instances over the fetched columns and the area the columns cover,
+  // border columns extend to infinity the same way Recast clips triangles
+  // into them
+  struct ColumnInstances {
+    std::vector<std::uint32_t> instances;
+    glm::vec2 min;
+    glm::vec2 max;
+  };
+
+  // Instances of the last column, spans of a column are processed together
+  mutable int m_instances_column;
+  mutable ColumnInstances m_column_instances;
+
   // Build heightfield and filter walkable low-height spans
   void build_filtered_heightfield();
+  void filter_low_height_spans();
+
+  // Rasterizes triangles into the heightfield and the triangle index, the
+  // first triangle gets the given index
+  void rasterize_triangles(rcContext &context, const float *vertices,
+                           std::size_t vertex_count, const int *triangles,
+                           std::size_t triangle_count, int first_triangle);
+  void rasterize_instance(rcContext &context, std::uint32_t instance,
+                          const std::vector<glm::vec3> &vertices,
+                          const std::vector<unsigned int> &indices);
+
+  // Recast indexes triangles from zero, so the function gets every column
+  // with the size it had before rasterization to fix added indices
+  template <typename F>
+  void rasterize_indexed(rcContext &context, const float *vertices,
+                         std::size_t vertex_count, const int *triangles,
+                         std::size_t triangle_count, F update_column);
   void mark_walkable_triangles(const float *vertices, const int *triangles,
                                std::size_t triangle_count,
                                unsigned char *areas) const;
@@ -62,11 +128,23 @@ private:
   auto slide_sphere_until_collision(int x, int y, int z, int direction) const
       -> bool;
   void drop_sphere(geometry::Sphere &sphere,
-                   const std::vector<geometry::Triangle> &triangles) const;
+                   const std::vector<geometry::Triangle> &triangles,
+                   const ColumnInstances &instances) const;
   auto triangles_at_columns(int x, int y, int radius) const
       -> std::vector<geometry::Triangle>;
-
-  // Utility
+  auto instances_at_columns(int x, int y, int radius) const
+      -> const ColumnInstances &;
+
+  // Only instance triangles returned by mesh hierarchies are transformed, the
+  // same triangles as map triangles over the fetched columns collide
+  template <typename P>
+  auto intersects_instances(const geometry::Sphere &sphere,
+                            const ColumnInstances &instances,
+                            P predicate) const -> bool;
+  auto instance_triangle(std::uint32_t instance, std::uint32_t triangle) const
+      -> const geometry::Triangle &;
+
+  // Utility, logs every 10% of columns
   void print_progress(int x, int y) const;
 };
 
@@ -0,0 +1,172 @@
+#include "pch.h"
+
+#include "TerrainCollider.h"
+
+namespace geodata {
+
+namespace {
+
+inline auto swap_y_with_z(const glm::vec3 &vector) -> glm::vec3 {
+  return {vector.x, vector.z, vector.y};
+}
+
+inline auto side(const glm::vec2 &a, const glm::vec2 &b,
+                 const glm::vec2 &point) -> float {
+
+  return (b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x);
+}
+
+// Highest Z of the sphere center above the point at which the sphere touches
+// the triangle (Z-up). Closest triangle feature is either its face, one of its
+// edges or vertices, each of them gives a closed-form solution.
+auto contact_height(const std::array<glm::vec3, 3> &triangle,
+                    const glm::vec2 &point, float radius)
+    -> std::optional<float> {
+
+  std::optional<float> height;
+
+  const auto update = [&height](float z) {
+    if (!height.has_value() || z > *height) {
+      height = z;
+    }
+  };
+
+  // Face: the sphere touches the plane and the touch point is inside
+  auto normal = glm::normalize(
+      glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0]));
+
+  if (normal.z < 0.0f) {
+    normal = -normal;
+  }
+
+  if (normal.z > 0.0f) {
+    const auto &a = triangle[0];
+    const auto z = a.z + (radius - normal.x * (point.x - a.x) -
+                          normal.y * (point.y - a.y)) /
+                             normal.z;
+
+    const auto touch = glm::vec2{point.x - normal.x * radius,
+                                 point.y - normal.y * radius};
+
+    const glm::vec2 v0{triangle[0]};
+    const glm::vec2 v1{triangle[1]};
+    const glm::vec2 v2{triangle[2]};
+
+    const auto s0 = side(v0, v1, touch);
+    const auto s1 = side(v1, v2, touch);
+    const auto s2 = side(v2, v0, touch);
+
+    if ((s0 >= 0.0f && s1 >= 0.0f && s2 >= 0.0f) ||
+        (s0 <= 0.0f && s1 <= 0.0f && s2 <= 0.0f)) {
+
+      update(z);
+    }
+  }
+
+  const auto radius_squared = radius * radius;
+
+  for (auto i = 0; i < 3; ++i) {
+    const auto &start = triangle[i];
+    const auto &end = triangle[(i + 1) % 3];
+
+    // Vertex: distance to the vertex is the radius
+    const auto offset = point - glm::vec2{start};
+    const auto distance_squared = glm::dot(offset, offset);
+
+    if (distance_squared <= radius_squared) {
+      update(start.z + std::sqrt(radius_squared - distance_squared));
+    }
+
+    // Edge: distance to the edge line is the radius and the closest point is
+    // on the edge, solved as a quadratic equation of the center height
+    const auto edge = end - start;
+    const auto length_squared = glm::dot(edge, edge);
+    const auto horizontal_length_squared = edge.x * edge.x + edge.y * edge.y;
+
+    if (horizontal_length_squared == 0.0f) {
+      continue;
+    }
+
+    const auto k = offset.x * edge.x + offset.y * edge.y;
+    const auto c = distance_squared * length_squared - k * k -
+                   radius_squared * length_squared;
+    const auto discriminant =
+        k * k * edge.z * edge.z - horizontal_length_squared * c;
+
+    if (discriminant < 0.0f) {
+      continue;
+    }
+
+    const auto u = (k * edge.z + std::sqrt(discriminant)) /
+                   horizontal_length_squared;
+    const auto t = (k + u * edge.z) / length_squared;
+
+    if (t >= 0.0f && t <= 1.0f) {
+      update(start.z + u);
+    }
+  }
+
+  return height;
+}
+
+} // namespace
+
+TerrainCollider::TerrainCollider(const Terrain &terrain)
+    : m_terrain{terrain} {}
+
+auto TerrainCollider::drop_height(const geometry::Sphere &sphere) const
+    -> std::optional<float> {
+
+  std::optional<float> height;
+
+  const glm::vec2 point{sphere.center.x, sphere.center.z};
+
+  m_terrain.for_each_quad(
+      footprint_min(sphere), footprint_max(sphere),
+      [this, &sphere, &point, &height](int x, int y) {
+        for (const auto &triangle : m_terrain.quad_triangles(x, y)) {
+          const auto z = contact_height(triangle, point, sphere.radius);
+
+          if (z.has_value() && (!height.has_value() || *z > *height)) {
+            height = z;
+          }
+        }
+      });
+
+  return height;
+}
+
+auto TerrainCollider::intersects(const geometry::Sphere &sphere) const
+    -> bool {
+
+  return intersects(sphere, [](const auto &) { return true; });
+}
+
+auto TerrainCollider::footprint_min(const geometry::Sphere &sphere) const
+    -> glm::vec2 {
+
+  return {sphere.center.x - sphere.radius, sphere.center.z - sphere.radius};
+}
+
+auto TerrainCollider::footprint_max(const geometry::Sphere &sphere) const
+    -> glm::vec2 {
+
+  return {sphere.center.x + sphere.radius, sphere.center.z + sphere.radius};
+}
+
+auto TerrainCollider::triangles(int x, int y) const
+    -> std::array<geometry::Triangle, 2> {
+
+  const auto quad_triangles = m_terrain.quad_triangles(x, y);
+
+  return {
+      geometry::Triangle{swap_y_with_z(quad_triangles[0][0]),
+                         swap_y_with_z(quad_triangles[0][1]),
+                         swap_y_with_z(quad_triangles[0][2])},
+      geometry::Triangle{swap_y_with_z(quad_triangles[1][0]),
+                         swap_y_with_z(quad_triangles[1][1]),
+                         swap_y_with_z(quad_triangles[1][2])},
+  };
+}
+
+} // namespace geodata
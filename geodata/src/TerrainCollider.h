@@ -0,0 +1,68 @@
+#pragma once
+
+#include <geodata/Terrain.h>
+
+#include <geometry/Intersection.h>
+#include <geometry/Sphere.h>
+#include <geometry/Triangle.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <optional>
+
+namespace geodata {
+
+// Collides spheres with the terrain heightmap in the Y-up coordinate system.
+// Sphere footprint covers only a few terrain quads, so terrain triangles are
+// found directly from the sphere position instead of triangle lists.
+class TerrainCollider {
+public:
+  explicit TerrainCollider(const Terrain &terrain);
+
+  // Height of the sphere center at which the sphere dropped from above touches
+  // the terrain, nothing if there's no terrain under the sphere
+  auto drop_height(const geometry::Sphere &sphere) const
+      -> std::optional<float>;
+
+  auto intersects(const geometry::Sphere &sphere) const -> bool;
+
+  // Returns true as soon as the predicate returns true for an intersection
+  // with one of terrain triangles
+  template <typename P>
+  auto intersects(const geometry::Sphere &sphere, P predicate) const -> bool {
+    auto found = false;
+
+    m_terrain.for_each_quad(
+        footprint_min(sphere), footprint_max(sphere),
+        [this, &sphere, &predicate, &found](int x, int y) {
+          if (found) {
+            return;
+          }
+
+          for (const auto &triangle : triangles(x, y)) {
+            geometry::Intersection intersection{};
+
+            if (sphere.intersects(triangle, intersection) &&
+                predicate(intersection)) {
+
+              found = true;
+              return;
+            }
+          }
+        });
+
+    return found;
+  }
+
+private:
+  const Terrain &m_terrain;
+
+  auto footprint_min(const geometry::Sphere &sphere) const -> glm::vec2;
+  auto footprint_max(const geometry::Sphere &sphere) const -> glm::vec2;
+
+  // Quad triangles in the Y-up coordinate system
+  auto triangles(int x, int y) const -> std::array<geometry::Triangle, 2>;
+};
+
+} // namespace geodata
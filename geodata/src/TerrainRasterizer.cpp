@@ -0,0 +1,340 @@
+#include "pch.h"
+
+#include "NSWE.h"
+#include "TerrainRasterizer.h"
+
+namespace geodata {
+
+namespace {
+
+// Convex polygon made by clipping a rectangle with a triangle
+struct Polygon {
+  std::array<glm::vec2, 8> points;
+  int size;
+};
+
+inline auto side(const glm::vec2 &a, const glm::vec2 &b,
+                 const glm::vec2 &point) -> float {
+
+  return (b.x - a.x) * (point.y - a.y) - (b.y - a.y) * (point.x - a.x);
+}
+
+// Keeps the part of the polygon to the left of the edge
+auto clip_polygon(const Polygon &polygon, const glm::vec2 &a,
+                  const glm::vec2 &b) -> Polygon {
+
+  Polygon clipped{{}, 0};
+
+  for (auto i = 0; i < polygon.size; ++i) {
+    const auto &current = polygon.points[i];
+    const auto &next = polygon.points[(i + 1) % polygon.size];
+
+    const auto current_side = side(a, b, current);
+    const auto next_side = side(a, b, next);
+
+    if (current_side >= 0.0f) {
+      clipped.points[clipped.size++] = current;
+    }
+
+    if ((current_side >= 0.0f) != (next_side >= 0.0f)) {
+      const auto t = current_side / (current_side - next_side);
+      clipped.points[clipped.size++] = current + (next - current) * t;
+    }
+  }
+
+  return clipped;
+}
+
+// Height of the triangle plane at the point, terrain triangles are never
+// vertical
+inline auto plane_height(const std::array<glm::vec3, 3> &triangle,
+                         const glm::vec3 &normal, const glm::vec2 &point)
+    -> float {
+
+  return triangle[0].z - (normal.x * (point.x - triangle[0].x) +
+                          normal.y * (point.y - triangle[0].y)) /
+                             normal.z;
+}
+
+// Height range of the triangle part over the rectangle, returns false if they
+// don't overlap
+auto height_range(const std::array<glm::vec3, 3> &triangle,
+                  const glm::vec2 &min, const glm::vec2 &max, float &min_z,
+                  float &max_z) -> bool {
+
+  Polygon polygon{{min, {max.x, min.y}, max, {min.x, max.y}}, 4};
+
+  // Clip counter-clockwise
+  auto a = glm::vec2{triangle[0]};
+  auto b = glm::vec2{triangle[1]};
+  auto c = glm::vec2{triangle[2]};
+
+  if (side(a, b, c) < 0.0f) {
+    std::swap(b, c);
+  }
+
+  polygon = clip_polygon(polygon, a, b);
+  polygon = clip_polygon(polygon, b, c);
+  polygon = clip_polygon(polygon, c, a);
+
+  if (polygon.size < 3) {
+    return false;
+  }
+
+  const auto normal = glm::cross(triangle[1] - triangle[0],
+                                 triangle[2] - triangle[0]);
+
+  min_z = std::numeric_limits<float>::max();
+  max_z = std::numeric_limits<float>::lowest();
+
+  for (auto i = 0; i < polygon.size; ++i) {
+    const auto z = plane_height(triangle, normal, polygon.points[i]);
+    min_z = std::min(min_z, z);
+    max_z = std::max(max_z, z);
+  }
+
+  return true;
+}
+
+// Height steps along both axes of the planar quad, nothing if the quad isn't
+// planar
+auto quad_slope(const Terrain &terrain, int x, int y)
+    -> std::optional<glm::vec2> {
+
+  const auto h00 = terrain.vertex(x + 0, y + 0).z;
+  const auto h10 = terrain.vertex(x + 1, y + 0).z;
+  const auto h01 = terrain.vertex(x + 0, y + 1).z;
+  const auto h11 = terrain.vertex(x + 1, y + 1).z;
+
+  if (h10 - h00 != h11 - h01) {
+    return std::nullopt;
+  }
+
+  return glm::vec2{h10 - h00, h01 - h00};
+}
+
+} // namespace
+
+TerrainRasterizer::TerrainRasterizer(const Terrain &terrain,
+                                     float walkable_slope)
+    : m_terrain{terrain}, m_walkable_slope{walkable_slope}, m_patches{},
+      m_quad_patches{} {
+
+  merge_coplanar_quads();
+}
+
+void TerrainRasterizer::rasterize(rcHeightfield &hf) const {
+  rcContext context{};
+
+  for (auto y = 0; y < hf.height; ++y) {
+    for (auto x = 0; x < hf.width; ++x) {
+      // Heightfield is Y-up, so its Z axis is the terrain Y axis
+      glm::vec2 column_min{hf.bmin[0] + x * hf.cs, hf.bmin[2] + y * hf.cs};
+      const auto column_max = column_min + hf.cs;
+
+      // Recast rasterizes parts of triangles outside of the heightfield into
+      // its first row and column, do the same to keep geodata unchanged
+      if (x == 0) {
+        column_min.x = std::min(column_min.x, m_terrain.origin.x);
+      }
+
+      if (y == 0) {
+        column_min.y = std::min(column_min.y, m_terrain.origin.y);
+      }
+
+      auto min_z = 0.0f;
+      auto max_z = 0.0f;
+
+      // Span of a patch is the union of its triangle spans only if no other
+      // triangles are merged in between, so the patch is used only when it
+      // covers all quads under the column
+      std::optional<int> column_patch;
+
+      m_terrain.for_each_quad(
+          column_min, column_max, [&](int quad_x, int quad_y) {
+            const auto patch =
+                m_quad_patches[quad_x + quad_y * (m_terrain.width - 1)];
+            column_patch = !column_patch.has_value() || *column_patch == patch
+                               ? patch
+                               : -1;
+          });
+
+      if (!column_patch.has_value()) {
+        continue;
+      }
+
+      if (*column_patch != -1) {
+        const auto &patch = m_patches[*column_patch];
+        patch_height_range(patch, column_min, column_max, min_z, max_z);
+        add_span(context, hf, x, y, min_z, max_z,
+                 m_terrain.quad_triangles(patch.min_x, patch.min_y)[0]);
+        continue;
+      }
+
+      const auto rasterize_quad = [&](int quad_x, int quad_y) {
+        for (const auto &triangle :
+             m_terrain.quad_triangles(quad_x, quad_y)) {
+
+          if (height_range(triangle, column_min, column_max, min_z, max_z)) {
+            add_span(context, hf, x, y, min_z, max_z, triangle);
+          }
+        }
+      };
+
+      m_terrain.for_each_quad(column_min, column_max, rasterize_quad);
+    }
+  }
+}
+
+void TerrainRasterizer::merge_coplanar_quads() {
+  const auto quads_x = m_terrain.width - 1;
+  const auto quads_y = m_terrain.height - 1;
+
+  m_quad_patches.assign(quads_x * quads_y, -1);
+
+  std::vector<std::optional<glm::vec2>> slopes(quads_x * quads_y);
+
+  for (auto y = 0; y < quads_y; ++y) {
+    for (auto x = 0; x < quads_x; ++x) {
+      // Holes split patches
+      if ((m_terrain.quad(x, y) & TERRAIN_QUAD_VISIBLE) != 0) {
+        slopes[x + y * quads_x] = quad_slope(m_terrain, x, y);
+      }
+    }
+  }
+
+  // Neighbour quads with the same slopes share an edge, so they are coplanar
+  const auto mergeable = [&](int x, int y, const glm::vec2 &slope) {
+    const auto index = x + y * quads_x;
+    return m_quad_patches[index] == -1 && slopes[index].has_value() &&
+           *slopes[index] == slope;
+  };
+
+  // Greedy rectangles: grow along X first, then along Y while the whole row
+  // of the rectangle can be merged
+  for (auto y = 0; y < quads_y; ++y) {
+    for (auto x = 0; x < quads_x; ++x) {
+      const auto &slope = slopes[x + y * quads_x];
+
+      if (!slope.has_value() || m_quad_patches[x + y * quads_x] != -1) {
+        continue;
+      }
+
+      auto max_x = x;
+
+      while (max_x + 1 < quads_x && mergeable(max_x + 1, y, *slope)) {
+        max_x++;
+      }
+
+      auto max_y = y;
+
+      while (max_y + 1 < quads_y) {
+        auto row_mergeable = true;
+
+        for (auto row_x = x; row_x <= max_x && row_mergeable; ++row_x) {
+          row_mergeable = mergeable(row_x, max_y + 1, *slope);
+        }
+
+        if (!row_mergeable) {
+          break;
+        }
+
+        max_y++;
+      }
+
+      // Single quads are rasterized as triangles
+      if (max_x == x && max_y == y) {
+        continue;
+      }
+
+      const auto patch = static_cast<int>(m_patches.size());
+      m_patches.push_back({x, y, max_x, max_y});
+
+      for (auto patch_y = y; patch_y <= max_y; ++patch_y) {
+        for (auto patch_x = x; patch_x <= max_x; ++patch_x) {
+          m_quad_patches[patch_x + patch_y * quads_x] = patch;
+        }
+      }
+    }
+  }
+
+  utils::Log(utils::LOG_INFO, "Geodata")
+      << "Merged terrain quads into " << m_patches.size() << " patches"
+      << std::endl;
+}
+
+void TerrainRasterizer::patch_height_range(const Patch &patch,
+                                           const glm::vec2 &min,
+                                           const glm::vec2 &max, float &min_z,
+                                           float &max_z) const {
+
+  const auto patch_min =
+      m_terrain.origin + glm::vec2{patch.min_x, patch.min_y} * m_terrain.scale;
+  const auto patch_max =
+      m_terrain.origin +
+      glm::vec2{patch.max_x + 1, patch.max_y + 1} * m_terrain.scale;
+
+  const glm::vec2 clipped_min{std::max(min.x, patch_min.x),
+                              std::max(min.y, patch_min.y)};
+  const glm::vec2 clipped_max{std::min(max.x, patch_max.x),
+                              std::min(max.y, patch_max.y)};
+
+  // Patch is planar, so any of its triangles gives its plane
+  const auto triangle = m_terrain.quad_triangles(patch.min_x, patch.min_y)[0];
+  const auto normal = glm::cross(triangle[1] - triangle[0],
+                                 triangle[2] - triangle[0]);
+
+  // Height is linear, so its range is at the rectangle corners
+  const std::array<glm::vec2, 4> corners{
+      clipped_min,
+      glm::vec2{clipped_max.x, clipped_min.y},
+      clipped_max,
+      glm::vec2{clipped_min.x, clipped_max.y},
+  };
+
+  min_z = std::numeric_limits<float>::max();
+  max_z = std::numeric_limits<float>::lowest();
+
+  for (const auto &corner : corners) {
+    const auto z = plane_height(triangle, normal, corner);
+    min_z = std::min(min_z, z);
+    max_z = std::max(max_z, z);
+  }
+}
+
+void TerrainRasterizer::add_span(
+    rcContext &context, rcHeightfield &hf, int x, int y, float min_z,
+    float max_z, const std::array<glm::vec3, 3> &triangle) const {
+
+  const auto max_height = hf.bmax[1] - hf.bmin[1];
+
+  min_z -= hf.bmin[1];
+  max_z -= hf.bmin[1];
+
+  if (max_z < 0.0f || min_z > max_height) {
+    return;
+  }
+
+  min_z = std::max(min_z, 0.0f);
+  max_z = std::min(max_z, max_height);
+
+  const auto inverse_cell_height = 1.0f / hf.ch;
+
+  const auto span_min =
+      std::clamp(static_cast<int>(std::floor(min_z * inverse_cell_height)), 0,
+                 RC_SPAN_MAX_HEIGHT);
+  const auto span_max =
+      std::clamp(static_cast<int>(std::ceil(max_z * inverse_cell_height)),
+                 span_min + 1, RC_SPAN_MAX_HEIGHT);
+
+  // Terrain always faces up
+  const auto normal = glm::normalize(
+      glm::cross(triangle[1] - triangle[0], triangle[2] - triangle[0]));
+  const auto area =
+      std::abs(normal.z) < m_walkable_slope ? RC_STEEP_AREA : RC_FLAT_AREA;
+
+  rcAddSpan(&context, hf, x, y, static_cast<unsigned short>(span_min),
+            static_cast<unsigned short>(span_max), area, 1);
+}
+
+} // namespace geodata
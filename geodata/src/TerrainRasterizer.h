@@ -0,0 +1,58 @@
+#pragma once
+
+#include <geodata/Terrain.h>
+
+#include "Recast.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+namespace geodata {
+
+// Rasterizes the terrain heightmap column by column: every heightfield column
+// clips only the few terrain triangles under it, so the terrain is never
+// triangulated and transformed as a whole. Coplanar visible quads are merged
+// into rectangular patches, a column over a single patch gets one span
+// instead of clipping every triangle under it.
+class TerrainRasterizer {
+public:
+  explicit TerrainRasterizer(const Terrain &terrain, float walkable_slope);
+
+  void rasterize(rcHeightfield &hf) const;
+
+private:
+  // Rectangle of coplanar quads, bounds are inclusive quad coordinates
+  struct Patch {
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+  };
+
+  const Terrain &m_terrain;
+
+  // Cosine of the max walkable angle
+  const float m_walkable_slope;
+
+  std::vector<Patch> m_patches;
+
+  // Patch index of every quad, -1 if the quad isn't merged
+  std::vector<int> m_quad_patches;
+
+  void merge_coplanar_quads();
+
+  // Height range of the patch part over the rectangle
+  void patch_height_range(const Patch &patch, const glm::vec2 &min,
+                          const glm::vec2 &max, float &min_z,
+                          float &max_z) const;
+
+  // Quantizes the height range the same way Recast does for triangles, area
+  // is taken from the triangle slope
+  void add_span(rcContext &context, rcHeightfield &hf, int x, int y,
+                float min_z, float max_z,
+                const std::array<glm::vec3, 3> &triangle) const;
+};
+
+} // namespace geodata
@@ -3,6 +3,7 @@
 #include <utils/Assert.h>
 #include <utils/ExtractionHelpers.h>
 #include <utils/Log.h>
+#include <utils/StreamBounds.h>
 
 #include <geometry/Box.h>
 #include <geometry/Sphere.h>
@@ -19,14 +20,20 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <bitset>
 #include <cmath>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
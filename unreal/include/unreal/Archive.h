@@ -7,13 +7,18 @@
 #include "PropertyExtractor.h"
 
 #include <utils/ExtractionHelpers.h>
+#include <utils/MemoryStreamBuffer.h>
 #include <utils/NonCopyable.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <initializer_list>
 #include <iostream>
 #include <memory>
-#include <sstream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -29,6 +34,9 @@ struct ObjectImport {
   Name class_name;
   std::int32_t package_index;
   Name object_name;
+
+  // Resolved object, guarded by the importing archive's object loader
+  std::shared_ptr<Object> object;
 };
 
 struct ObjectExport {
@@ -40,6 +48,7 @@ struct ObjectExport {
   Index serial_size;
   Index serial_offset;
 
+  // Published once by the object loader, guarded by its mutex
   std::shared_ptr<Object> object;
 };
 
@@ -76,9 +85,12 @@ struct PackageHeader {
   std::vector<GenerationInfo> generations;
 };
 
+class ArchiveCursor;
+
 class Archive : public utils::NonCopyable {
 private:
-  mutable NameTable m_name_table;
+  NameTable m_name_table;
+  Name m_none_name;
 
 public:
   const ObjectLoader object_loader;
@@ -92,19 +104,22 @@ public:
   mutable std::vector<ObjectImport> import_map;
   mutable std::vector<ObjectExport> export_map;
 
-  explicit Archive(const std::string &name, std::stringstream input,
+  // Archive takes ownership of the decrypted package data, objects and
+  // properties may keep views into it for the archive lifetime
+  explicit Archive(const std::string &name, std::vector<char> buffer,
                    const ArchiveLoader &archive_loader);
 
-  Archive(Archive &&other)
-      : object_loader{other.object_loader},
-        property_extractor{other.property_extractor}, name{std::move(
-                                                          other.name)},
-        header{std::move(other.header)}, name_map{std::move(other.name_map)},
-        import_map{std::move(other.import_map)},
-        export_map{std::move(other.export_map)}, m_input{std::move(
-                                                     other.m_input)} {}
+  // Reads go through the calling thread's cursor if one is open on this
+  // archive, otherwise through the archive's own stream
+  operator std::istream &() { return input(); }
 
-  operator std::istream &() { return m_input; }
+  auto buffer_size() const -> std::size_t { return m_buffer.size(); }
+  auto objects_in_use() const -> bool {
+    return object_loader.objects_in_use();
+  }
+
+  // Returns a view of the next `size` bytes and skips them
+  auto view(std::size_t size) -> std::span<const std::uint8_t>;
 
   auto object_name(Index index) const -> Name;
 
@@ -135,15 +150,29 @@ public:
     return *this;
   }
 
+  // Indices into export_map of all exports of the given class, in export order
+  auto class_exports(std::string_view class_name) const
+      -> const std::vector<std::size_t> &;
+
   template <typename T>
   void load_objects(const std::string &class_name,
                     std::vector<std::shared_ptr<T>> &objects) const {
 
-    for (auto &object_export : export_map) {
-      if (object_export.class_name == class_name) {
-        objects.push_back(std::dynamic_pointer_cast<T>(
-            object_loader.export_object(object_export)));
-      }
+    const auto &indices = class_exports(class_name);
+    objects.reserve(objects.size() + indices.size());
+
+    for (const auto index : indices) {
+      objects.push_back(std::dynamic_pointer_cast<T>(
+          object_loader.export_object(export_map[index])));
+    }
+  }
+
+  template <typename T>
+  void load_objects(std::initializer_list<std::string> class_names,
+                    std::vector<std::shared_ptr<T>> &objects) const {
+
+    for (const auto &class_name : class_names) {
+      load_objects(class_name, objects);
     }
   }
 
@@ -152,8 +181,43 @@ public:
   friend auto operator<<(std::ostream &output, const Archive &archive)
       -> std::ostream &;
 
+  friend class ArchiveCursor;
+  friend class ArchiveCache;
+
 private:
-  std::stringstream m_input;
+  // Leaves tables empty, used to restore archives from the package cache
+  struct Unparsed {};
+
+  explicit Archive(Unparsed, const std::string &name, std::vector<char> buffer,
+                   const ArchiveLoader &archive_loader);
+
+  std::unordered_map<std::string_view, std::vector<std::size_t>> m_class_index;
+
+  std::vector<char> m_buffer;
+  utils::MemoryStreamBuffer m_stream_buffer;
+  std::istream m_input;
+
+  auto input() -> std::istream &;
+  void index_classes();
+};
+
+// Thread-local read position in an archive. Objects are deserialized through
+// their own cursor, so exports of the same archive can be loaded from several
+// threads at once. The archive stream itself is only used while parsing the
+// package tables.
+class ArchiveCursor : public utils::NonCopyable {
+public:
+  explicit ArchiveCursor(Archive &archive, std::size_t offset);
+  ~ArchiveCursor();
+
+private:
+  Archive &m_archive;
+  ArchiveCursor *m_previous;
+
+  utils::MemoryStreamBuffer m_stream_buffer;
+  std::istream m_input;
+
+  friend class Archive;
 };
 
 } // namespace unreal
@@ -3,10 +3,20 @@
 #include "Archive.h"
 #include "NameTable.h"
 
+#include <utils/NonCopyable.h>
+#include <utils/ThreadPool.h>
+
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
-#include <sstream>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace unreal {
@@ -20,26 +30,118 @@ struct SearchConfig {
       : directory{directory}, extension{extension} {}
 };
 
+class ArchiveCache;
+
+struct CacheConfig {
+  // Decrypted packages are also cached on disk here, unless it's empty
+  std::filesystem::path directory;
+
+  // Unused packages are evicted when loaded package data exceeds this many
+  // bytes, 0 means unlimited
+  std::size_t memory_budget;
+};
+
+struct CacheStatistics {
+  std::size_t hits;
+  std::size_t misses;
+  std::size_t evictions;
+  std::size_t resident_bytes;
+};
+
+struct PackageFile {
+  std::filesystem::path path;
+  std::uintmax_t size;
+  std::filesystem::file_time_type modified;
+};
+
+// Records packages used by the calling thread while alive, including ones
+// already loaded by other threads, so inputs of a map can be tracked.
+// Recorders nest, inner ones pass their packages to the outer one.
+class PackageRecorder : public utils::NonCopyable {
+public:
+  explicit PackageRecorder();
+  ~PackageRecorder();
+
+  // Lowercase package names
+  auto packages() const -> const std::unordered_set<std::string> & {
+    return m_packages;
+  }
+
+  static void record(std::string_view name);
+
+private:
+  PackageRecorder *m_previous;
+  std::unordered_set<std::string> m_packages;
+};
+
 class ArchiveLoader {
 public:
+  // Scans the search directories once, later lookups don't touch the
+  // filesystem until the package is actually loaded
   explicit ArchiveLoader(const std::filesystem::path &root_path,
-                         const std::vector<SearchConfig> &configs)
-      : m_root_path{root_path}, m_configs{configs} {}
+                         const std::vector<SearchConfig> &configs,
+                         const CacheConfig &cache_config = {});
+  ~ArchiveLoader();
+
+  // Thread-safe, concurrent requests for the same package wait for the
+  // thread which loads it first. The archive can't be evicted while the
+  // returned pointer or any object exported from it is held.
+  auto load_archive(const std::string &name) const -> std::shared_ptr<Archive>;
+
+  // Starts loading packages imported by the archive in the background, so
+  // they are ready by the time its objects resolve their imports. Only
+  // packages with the given extensions are loaded, all if there are none.
+  void prefetch_imports(const Archive &archive,
+                        const std::vector<std::string> &extensions) const;
 
-  auto load_archive(const std::string &name) const -> Archive *;
+  // Case-insensitive, the first search config containing the package wins
+  auto find_package(const std::string &name) const -> const PackageFile *;
+
+  auto statistics() const -> CacheStatistics;
 
 private:
+  static constexpr auto PREFETCH_THREAD_COUNT = 4;
+
+  struct CachedArchive {
+    std::shared_future<void> loaded;
+    std::shared_ptr<Archive> archive;
+    std::uint64_t last_used;
+  };
+
   const std::filesystem::path m_root_path;
   const std::vector<SearchConfig> m_configs;
+  const std::size_t m_memory_budget;
+
+  // Package index and archive cache are keyed by lowercase package name
+  std::unordered_map<std::string, PackageFile> m_package_index;
+
+  std::unique_ptr<ArchiveCache> m_cache;
+
+  mutable std::mutex m_mutex;
+  mutable std::unordered_map<std::string, CachedArchive> m_archives;
+  mutable std::uint64_t m_use_counter;
+  mutable CacheStatistics m_statistics;
+
+  // Running prefetches by package name, finished ones are collected on the
+  // next prefetch to report their failures
+  mutable std::vector<std::pair<std::string, std::future<void>>> m_prefetches;
+
+  // Must be declared last, workers use the cache until they are joined
+  mutable utils::ThreadPool m_prefetch_pool;
+
+  void index_packages();
 
-  mutable std::unordered_map<std::string, Archive> m_archives;
+  auto find_and_load_archive(const std::string &name) const
+      -> std::unique_ptr<Archive>;
+  auto load_archive(const std::string &name, const PackageFile &file) const
+      -> std::unique_ptr<Archive>;
 
-  auto load_and_cache_archive(const std::string &name,
-                              const std::filesystem::path &path) const
-      -> Archive *;
+  // Must be called with the mutex locked
+  void evict_unused() const;
+  void collect_prefetches() const;
 
   void dump_decrypted(const std::filesystem::path &path,
-                      const std::stringstream &decrypted) const;
+                      const std::vector<char> &decrypted) const;
 };
 
 } // namespace unreal
@@ -8,6 +8,7 @@
 #include "Property.h"
 
 #include <cstdint>
+#include <span>
 #include <vector>
 
 namespace unreal {
@@ -119,7 +120,7 @@ public:
 
 struct Mipmap {
   std::int32_t unknown; // ??? Pointer to data, valid only when locked
-  std::vector<std::uint8_t> data;
+  std::span<const std::uint8_t> data; // Points into the archive buffer
   std::int32_t u_size, v_size; // Power of two tile dimensions
   std::int8_t u_bits, v_bits;  // Power of two tile bits
 
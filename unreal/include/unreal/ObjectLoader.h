@@ -3,6 +3,7 @@
 #include "Index.h"
 
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -28,12 +29,18 @@ public:
   auto export_object(ObjectExport &object_export) const
       -> std::shared_ptr<Object>;
 
+  // Whether any exported object is referenced outside of the archive
+  auto objects_in_use() const -> bool;
+
   friend auto operator<<(std::ostream &output,
                          const ObjectLoader &object_loader) -> std::ostream &;
 
 private:
   Archive &m_archive;
   const ArchiveLoader &m_archive_loader;
+
+  // Guards objects published into the archive import and export maps
+  mutable std::mutex m_mutex;
 };
 
 } // namespace unreal
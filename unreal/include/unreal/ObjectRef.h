@@ -20,7 +20,7 @@ template <typename T,
           ObjectRefRequirement requirement = ObjectRefRequirement::Required>
 class ObjectRef {
 public:
-  ObjectRef() : m_index{}, m_object_loader{nullptr}, m_object{nullptr} {}
+  ObjectRef() : m_index{}, m_object_loader{nullptr} {}
 
   auto operator->() const -> std::shared_ptr<T> { return load_object<T>(); }
   operator std::shared_ptr<T>() const { return load_object<T>(); }
@@ -53,23 +53,18 @@ private:
   Index m_index;
   const ObjectLoader *m_object_loader;
 
-  mutable std::shared_ptr<T> m_object;
-
   template <typename U> auto load_object() const -> std::shared_ptr<U> {
     if (requirement == ObjectRefRequirement::Optional && m_index == 0) {
       return nullptr;
     }
 
-    if (m_object == nullptr) {
-      ASSERT(m_object_loader != nullptr, "Unreal",
-             "Object loader must be initialized");
-      ASSERT(m_index != 0, "Unreal", "Index can't be equal to zero");
-
-      m_object =
-          std::dynamic_pointer_cast<U>(m_object_loader->load_object(m_index));
-    }
+    // Loaded objects are cached by the object loader, references stay
+    // immutable and can be shared between threads
+    ASSERT(m_object_loader != nullptr, "Unreal",
+           "Object loader must be initialized");
+    ASSERT(m_index != 0, "Unreal", "Index can't be equal to zero");
 
-    return std::dynamic_pointer_cast<U>(m_object);
+    return std::dynamic_pointer_cast<U>(m_object_loader->load_object(m_index));
   }
 };
 
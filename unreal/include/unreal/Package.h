@@ -2,6 +2,7 @@
 
 #include "Archive.h"
 
+#include <initializer_list>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -12,22 +13,31 @@ namespace unreal {
 
 class Package {
 public:
-  explicit Package(Archive &archive) : m_archive{archive} {}
+  // Keeps the archive loaded while the package is alive
+  explicit Package(std::shared_ptr<Archive> archive)
+      : m_archive{std::move(archive)} {}
 
   template <typename T>
   void load_objects(const std::string &class_name,
                     std::vector<std::shared_ptr<T>> &objects) const {
 
-    m_archive.load_objects(class_name, objects);
+    m_archive->load_objects(class_name, objects);
   }
 
-  auto name() const -> std::string { return std::string{m_archive.name}; }
+  template <typename T>
+  void load_objects(std::initializer_list<std::string> class_names,
+                    std::vector<std::shared_ptr<T>> &objects) const {
+
+    m_archive->load_objects(class_names, objects);
+  }
+
+  auto name() const -> std::string { return std::string{m_archive->name}; }
 
   friend auto operator<<(std::ostream &output, const Package &package)
       -> std::ostream &;
 
 private:
-  Archive &m_archive;
+  std::shared_ptr<Archive> m_archive;
 };
 
 } // namespace unreal
@@ -13,10 +13,24 @@ namespace unreal {
 class PackageLoader {
 public:
   explicit PackageLoader(const std::filesystem::path &root_path,
-                         const std::vector<SearchConfig> &configs)
-      : m_archive_loader{root_path, configs} {}
+                         const std::vector<SearchConfig> &configs,
+                         const CacheConfig &cache_config = {})
+      : m_archive_loader{root_path, configs, cache_config} {}
 
-  auto load_package(const std::string &name) const -> std::optional<Package>;
+  // Imported packages are prefetched in the background unless only a few
+  // objects of the package itself are going to be read. Prefetch can be
+  // limited to packages with the given extensions, like "usx".
+  auto load_package(const std::string &name, bool prefetch = true,
+                    const std::vector<std::string> &prefetch_extensions = {})
+      const -> std::optional<Package>;
+
+  auto find_package(const std::string &name) const -> const PackageFile * {
+    return m_archive_loader.find_package(name);
+  }
+
+  auto cache_statistics() const -> CacheStatistics {
+    return m_archive_loader.statistics();
+  }
 
 private:
   ArchiveLoader m_archive_loader;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <utils/ExtractionHelpers.h>
+
 #include <cstdint>
+#include <type_traits>
 
 namespace unreal {
 
@@ -12,18 +15,24 @@ struct Color {
   friend auto operator>>(Archive &archive, Color &color) -> Archive &;
 };
 
+static_assert(sizeof(Color) == 4);
+
 struct Vector {
   float x, y, z;
 
   friend auto operator>>(Archive &archive, Vector &vector) -> Archive &;
 };
 
+static_assert(sizeof(Vector) == 12);
+
 struct Plane {
   float x, y, z, w;
 
   friend auto operator>>(Archive &archive, Plane &plane) -> Archive &;
 };
 
+static_assert(sizeof(Plane) == 16);
+
 struct Rotator {
   std::int32_t pitch; // y: -pitch * pi / 32768.0f
   std::int32_t yaw;   // z: yaw * pi / 32768.0f
@@ -95,3 +104,11 @@ struct Quat {
 };
 
 } // namespace unreal
+
+namespace utils {
+
+template <> struct is_bulk_extractable<unreal::Color> : std::true_type {};
+template <> struct is_bulk_extractable<unreal::Vector> : std::true_type {};
+template <> struct is_bulk_extractable<unreal::Plane> : std::true_type {};
+
+} // namespace utils
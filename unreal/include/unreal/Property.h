@@ -7,9 +7,11 @@
 
 #include <utils/Assert.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
-#include <unordered_map>
+#include <span>
+#include <string_view>
 #include <vector>
 
 namespace unreal {
@@ -58,13 +60,18 @@ struct Property {
     Rotator rotator_value;
   };
 
-  std::vector<std::uint8_t> data_value;
-  std::vector<std::unordered_map<std::string, Property>> subproperties;
+  // Points into the archive buffer
+  std::span<const std::uint8_t> data_value;
+
+  // Struct and array sub-properties stored flat, element i spans
+  // [subproperty_offsets[i], subproperty_offsets[i + 1])
+  std::vector<Property> subproperties;
+  std::vector<std::uint32_t> subproperty_offsets;
 
   auto bool_value() const -> bool;
 
-  auto subproperty(const std::string &name, std::size_t index = 0) const
-      -> Property;
+  auto subproperty(std::string_view name, std::size_t index = 0) const
+      -> const Property &;
 
   friend auto operator<<(std::ostream &output, const Property &property)
       -> std::ostream &;
@@ -1,11 +1,9 @@
 #pragma once
 
+#include "Name.h"
 #include "Property.h"
 
 #include <cstdint>
-#include <string>
-#include <unordered_map>
-#include <vector>
 
 namespace unreal {
 
@@ -15,15 +13,27 @@ class PropertyExtractor {
 public:
   explicit PropertyExtractor(Archive &archive) : m_archive{archive} {}
 
-  auto extract_properties() const -> std::vector<Property>;
+  // Decodes properties one by one and hands each to the visitor as soon as it
+  // is read, no intermediate containers are built
+  template <typename Visitor> void extract_properties(Visitor &&visitor) const {
+    while (true) {
+      Property property{};
+      deserialize(property);
+
+      if (property.name == Name::NONE) {
+        break;
+      }
+
+      visitor(property);
+    }
+  }
 
 private:
   Archive &m_archive;
 
   void deserialize(Property &property) const;
   auto extract_size(std::uint8_t size_type) const -> std::uint32_t;
-  auto extract_properties_map() const
-      -> std::unordered_map<std::string, Property>;
+  void extract_subproperties(Property &property) const;
 };
 
 } // namespace unreal
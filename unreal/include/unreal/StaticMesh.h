@@ -9,7 +9,10 @@
 #include "Primitives.h"
 #include "Property.h"
 
+#include <utils/ExtractionHelpers.h>
+
 #include <cstdint>
+#include <type_traits>
 #include <vector>
 
 namespace unreal {
@@ -33,6 +36,8 @@ struct StaticMeshVertex {
       -> Archive &;
 };
 
+static_assert(sizeof(StaticMeshVertex) == 24);
+
 struct StaticMeshVertexStream {
   std::vector<StaticMeshVertex> vertices;
   std::uint32_t revision;
@@ -55,6 +60,8 @@ struct StaticMeshUV {
   friend auto operator>>(Archive &archive, StaticMeshUV &uv) -> Archive &;
 };
 
+static_assert(sizeof(StaticMeshUV) == 8);
+
 struct StaticMeshUVStream {
   std::vector<StaticMeshUV> uvs;
   std::uint32_t coordinate_index;
@@ -101,3 +108,12 @@ public:
 };
 
 } // namespace unreal
+
+namespace utils {
+
+template <>
+struct is_bulk_extractable<unreal::StaticMeshVertex> : std::true_type {};
+template <>
+struct is_bulk_extractable<unreal::StaticMeshUV> : std::true_type {};
+
+} // namespace utils
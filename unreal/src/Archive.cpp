@@ -5,10 +5,31 @@
 
 namespace unreal {
 
-Archive::Archive(const std::string &name, std::stringstream input,
+namespace {
+
+// Innermost cursor opened on the calling thread
+thread_local ArchiveCursor *current_cursor = nullptr;
+
+} // namespace
+
+ArchiveCursor::ArchiveCursor(Archive &archive, std::size_t offset)
+    : m_archive{archive}, m_previous{current_cursor},
+      m_stream_buffer{archive.m_buffer.data(), archive.m_buffer.size()},
+      m_input{&m_stream_buffer} {
+
+  m_input.seekg(static_cast<std::streamoff>(offset));
+  current_cursor = this;
+}
+
+ArchiveCursor::~ArchiveCursor() {
+  ASSERT(current_cursor == this, "Unreal",
+         "Archive cursors must be closed in reverse order");
+  current_cursor = m_previous;
+}
+
+Archive::Archive(const std::string &name, std::vector<char> buffer,
                  const ArchiveLoader &archive_loader)
-    : object_loader{*this, archive_loader}, property_extractor{*this},
-      name{m_name_table.name(name)}, m_input{std::move(input)} {
+    : Archive{Unparsed{}, name, std::move(buffer), archive_loader} {
 
   *this >> header;
 
@@ -33,6 +54,61 @@ Archive::Archive(const std::string &name, std::stringstream input,
     *this >> object_export;
     export_map.push_back(std::move(object_export));
   }
+
+  index_classes();
+}
+
+Archive::Archive(Unparsed, const std::string &name, std::vector<char> buffer,
+                 const ArchiveLoader &archive_loader)
+    : m_none_name{m_name_table.name(Name::NONE)},
+      object_loader{*this, archive_loader}, property_extractor{*this},
+      name{m_name_table.name(name)}, m_buffer{std::move(buffer)},
+      m_stream_buffer{m_buffer.data(), m_buffer.size()}, m_input{
+                                                             &m_stream_buffer} {
+}
+
+void Archive::index_classes() {
+  for (std::size_t i = 0; i < export_map.size(); ++i) {
+    m_class_index[export_map[i].class_name].push_back(i);
+  }
+}
+
+auto Archive::class_exports(std::string_view class_name) const
+    -> const std::vector<std::size_t> & {
+
+  static const std::vector<std::size_t> empty;
+
+  const auto pair = m_class_index.find(class_name);
+  return pair != m_class_index.end() ? pair->second : empty;
+}
+
+auto Archive::input() -> std::istream & {
+  for (auto *cursor = current_cursor; cursor != nullptr;
+       cursor = cursor->m_previous) {
+
+    if (&cursor->m_archive == this) {
+      return cursor->m_input;
+    }
+  }
+
+  return m_input;
+}
+
+auto Archive::view(std::size_t size) -> std::span<const std::uint8_t> {
+  auto &input = this->input();
+  const auto position = input.tellg();
+
+  if (position < 0 ||
+      static_cast<std::size_t>(position) + size > m_buffer.size()) {
+    ASSERT(false, "Unreal", "View out of archive bounds");
+    input.setstate(std::ios::failbit);
+    return {};
+  }
+
+  input.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+
+  return {reinterpret_cast<const std::uint8_t *>(m_buffer.data()) + position,
+          size};
 }
 
 auto Archive::object_name(Index index) const -> Name {
@@ -48,7 +124,7 @@ auto Archive::object_name(Index index) const -> Name {
     return export_map[index - 1].object_name;
   }
 
-  return m_name_table.none_name();
+  return m_none_name;
 }
 
 auto Archive::operator>>(PackageHeader &header) -> Archive & {
@@ -93,7 +169,7 @@ auto Archive::operator>>(Name &name) -> Archive & {
   if (static_cast<std::size_t>(index) < name_map.size()) {
     name = name_map[index];
   } else {
-    name = m_name_table.none_name();
+    name = m_none_name;
   }
 
   return *this;
@@ -152,12 +228,12 @@ auto Archive::operator>>(ObjectExport &object_export) -> Archive & {
 }
 
 auto Archive::operator>>(char &value) -> Archive & {
-  m_input >> value;
+  input() >> value;
   return *this;
 }
 
 auto Archive::operator>>(float &value) -> Archive & {
-  m_input.read(reinterpret_cast<char *>(&value), sizeof(value));
+  input().read(reinterpret_cast<char *>(&value), sizeof(value));
   return *this;
 }
 
@@ -0,0 +1,320 @@
+#include "pch.h"
+
+#include "ArchiveCache.h"
+
+namespace unreal {
+
+namespace {
+
+constexpr std::uint32_t NO_NAME = 0xffffffff;
+
+template <typename T> void write(std::ostream &output, const T &value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> auto read(std::istream &input) -> T {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value{};
+  input.read(reinterpret_cast<char *>(&value), sizeof(value));
+  return value;
+}
+
+void write_string(std::ostream &output, std::string_view string) {
+  write(output, static_cast<std::uint32_t>(string.size()));
+  output.write(string.data(), static_cast<std::streamsize>(string.size()));
+}
+
+auto read_string(std::istream &input, std::uint64_t input_size)
+    -> std::string {
+
+  const auto size = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, size, 1)) {
+    return {};
+  }
+
+  std::string string(size, '\0');
+  input.read(string.data(), static_cast<std::streamsize>(string.size()));
+  return string;
+}
+
+void write_header(std::ostream &output, const PackageHeader &header) {
+  write(output, header.magic);
+  write(output, header.file_version);
+  write(output, header.license_version);
+  write(output, header.flags);
+  write(output, header.name_count);
+  write(output, header.name_offset);
+  write(output, header.export_count);
+  write(output, header.export_offset);
+  write(output, header.import_count);
+  write(output, header.import_offset);
+  write(output, header.guid);
+  write(output, header.generation_count);
+  write(output, static_cast<std::uint32_t>(header.generations.size()));
+
+  for (const auto &generation : header.generations) {
+    write(output, generation);
+  }
+}
+
+void read_header(std::istream &input, std::uint64_t input_size,
+                 PackageHeader &header) {
+
+  header.magic = read<std::int32_t>(input);
+  header.file_version = read<std::int16_t>(input);
+  header.license_version = read<std::int16_t>(input);
+  header.flags = read<std::uint32_t>(input);
+  header.name_count = read<std::int32_t>(input);
+  header.name_offset = read<std::int32_t>(input);
+  header.export_count = read<std::int32_t>(input);
+  header.export_offset = read<std::int32_t>(input);
+  header.import_count = read<std::int32_t>(input);
+  header.import_offset = read<std::int32_t>(input);
+  header.guid = read<GUID>(input);
+  header.generation_count = read<std::int32_t>(input);
+  const auto generation_count = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, generation_count,
+                   sizeof(GenerationInfo))) {
+
+    return;
+  }
+
+  header.generations.resize(generation_count);
+
+  for (auto &generation : header.generations) {
+    generation = read<GenerationInfo>(input);
+  }
+}
+
+auto modification_time(const PackageFile &file) -> std::int64_t {
+  return static_cast<std::int64_t>(file.modified.time_since_epoch().count());
+}
+
+} // namespace
+
+ArchiveCache::ArchiveCache(const std::filesystem::path &directory)
+    : m_directory{directory} {
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+
+  if (error) {
+    utils::Log(utils::LOG_WARN, "Unreal")
+        << "Can't create package cache directory: " << m_directory
+        << std::endl;
+  }
+}
+
+auto ArchiveCache::entry_path(const PackageFile &file) const
+    -> std::filesystem::path {
+
+  auto filename = file.path.filename();
+  filename += ".cache";
+  return m_directory / filename;
+}
+
+auto ArchiveCache::load(const std::string &name, const PackageFile &file,
+                        const ArchiveLoader &archive_loader) const
+    -> std::unique_ptr<Archive> {
+
+  const auto path = entry_path(file);
+
+  std::error_code error;
+  const auto input_size = std::filesystem::file_size(path, error);
+  std::ifstream input{path, std::ios::binary};
+
+  if (error || !input) {
+    return nullptr;
+  }
+
+  if (read<std::uint32_t>(input) != CACHE_MAGIC ||
+      read<std::uint32_t>(input) != CACHE_VERSION ||
+      read_string(input, input_size) != file.path.string() ||
+      read<std::uint64_t>(input) != file.size ||
+      read<std::int64_t>(input) != modification_time(file) || !input) {
+
+    return nullptr;
+  }
+
+  const auto corrupted = [&path] {
+    utils::Log(utils::LOG_WARN, "Unreal")
+        << "Corrupted package cache entry: " << path << std::endl;
+    return nullptr;
+  };
+
+  // Payload goes straight into the buffer owned by the archive
+  const auto buffer_size = read<std::uint64_t>(input);
+
+  if (!utils::fits(input, input_size, buffer_size, 1)) {
+    return corrupted();
+  }
+
+  std::vector<char> buffer(buffer_size);
+  input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+  std::unique_ptr<Archive> archive{new Archive{
+      Archive::Unparsed{}, name, std::move(buffer), archive_loader}};
+
+  read_header(input, input_size, archive->header);
+
+  const auto name_at = [&archive](std::uint32_t index) {
+    return index < archive->name_map.size() ? archive->name_map[index]
+                                            : archive->m_none_name;
+  };
+
+  // Smallest sizes of the table entries
+  constexpr auto name_size = sizeof(std::uint32_t);
+  constexpr auto import_size = 4 * sizeof(std::uint32_t);
+  constexpr auto export_size = 5 * sizeof(std::uint32_t) + 2 * sizeof(Index);
+
+  const auto name_count = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, name_count, name_size)) {
+    return corrupted();
+  }
+
+  archive->name_map.resize(name_count);
+
+  for (auto &name_entry : archive->name_map) {
+    name_entry = archive->m_name_table.name(read_string(input, input_size));
+  }
+
+  const auto import_count = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, import_count, import_size)) {
+    return corrupted();
+  }
+
+  archive->import_map.resize(import_count);
+
+  for (auto &import : archive->import_map) {
+    import.class_package = name_at(read<std::uint32_t>(input));
+    import.class_name = name_at(read<std::uint32_t>(input));
+    import.package_index = read<std::int32_t>(input);
+    import.object_name = name_at(read<std::uint32_t>(input));
+  }
+
+  const auto export_count = read<std::uint32_t>(input);
+
+  if (!utils::fits(input, input_size, export_count, export_size)) {
+    return corrupted();
+  }
+
+  archive->export_map.resize(export_count);
+
+  for (auto &object_export : archive->export_map) {
+    object_export.class_name = name_at(read<std::uint32_t>(input));
+    object_export.super_name = name_at(read<std::uint32_t>(input));
+    object_export.package_index = read<std::int32_t>(input);
+    object_export.object_name = name_at(read<std::uint32_t>(input));
+    object_export.object_flags = read<std::uint32_t>(input);
+    object_export.serial_size = read<Index>(input);
+    object_export.serial_offset = read<Index>(input);
+
+    // Objects are read from their serial range of the payload
+    if (object_export.serial_size > 0 &&
+        (object_export.serial_offset < 0 ||
+         static_cast<std::uint64_t>(object_export.serial_offset) +
+                 static_cast<std::uint64_t>(object_export.serial_size) >
+             buffer_size)) {
+
+      return corrupted();
+    }
+  }
+
+  if (!input) {
+    return corrupted();
+  }
+
+  archive->index_classes();
+  return archive;
+}
+
+void ArchiveCache::store(const Archive &archive,
+                         const PackageFile &file) const {
+
+  const auto path = entry_path(file);
+
+  // Write to a unique temporary file and rename it, so concurrent runs never
+  // see partially written entries
+  auto temporary_path = path;
+  temporary_path += ".";
+  temporary_path += std::to_string(std::random_device{}());
+  temporary_path += ".tmp";
+
+  std::error_code error;
+
+  {
+    std::ofstream output{temporary_path, std::ios::binary};
+
+    std::unordered_map<const char *, std::uint32_t> name_indices;
+
+    for (std::uint32_t i = 0; i < archive.name_map.size(); ++i) {
+      name_indices.try_emplace(archive.name_map[i].data(), i);
+    }
+
+    const auto write_name = [&output, &name_indices](const Name &name) {
+      const auto pair = name_indices.find(name.data());
+      write(output, pair != name_indices.end() ? pair->second : NO_NAME);
+    };
+
+    write(output, CACHE_MAGIC);
+    write(output, CACHE_VERSION);
+    write_string(output, file.path.string());
+    write(output, static_cast<std::uint64_t>(file.size));
+    write(output, modification_time(file));
+
+    write(output, static_cast<std::uint64_t>(archive.m_buffer.size()));
+    output.write(archive.m_buffer.data(),
+                 static_cast<std::streamsize>(archive.m_buffer.size()));
+
+    write_header(output, archive.header);
+
+    write(output, static_cast<std::uint32_t>(archive.name_map.size()));
+
+    for (const auto &name : archive.name_map) {
+      write_string(output, name);
+    }
+
+    write(output, static_cast<std::uint32_t>(archive.import_map.size()));
+
+    for (const auto &import : archive.import_map) {
+      write_name(import.class_package);
+      write_name(import.class_name);
+      write(output, import.package_index);
+      write_name(import.object_name);
+    }
+
+    write(output, static_cast<std::uint32_t>(archive.export_map.size()));
+
+    for (const auto &object_export : archive.export_map) {
+      write_name(object_export.class_name);
+      write_name(object_export.super_name);
+      write(output, object_export.package_index);
+      write_name(object_export.object_name);
+      write(output, object_export.object_flags);
+      write(output, object_export.serial_size);
+      write(output, object_export.serial_offset);
+    }
+
+    output.close();
+
+    if (!output) {
+      utils::Log(utils::LOG_WARN, "Unreal")
+          << "Can't write package cache entry: " << path << std::endl;
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary_path, path, error);
+
+  if (error) {
+    std::filesystem::remove(temporary_path, error);
+  }
+}
+
+} // namespace unreal
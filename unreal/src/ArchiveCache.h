@@ -0,0 +1,35 @@
+#pragma once
+
+#include <unreal/Archive.h>
+#include <unreal/ArchiveLoader.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+namespace unreal {
+
+// On-disk cache of decrypted packages with their parsed tables. Entries are
+// validated against the source path, size and modification time.
+class ArchiveCache {
+public:
+  explicit ArchiveCache(const std::filesystem::path &directory);
+
+  // Returns nullptr if there's no up to date entry for the package
+  auto load(const std::string &name, const PackageFile &file,
+            const ArchiveLoader &archive_loader) const
+      -> std::unique_ptr<Archive>;
+
+  void store(const Archive &archive, const PackageFile &file) const;
+
+private:
+  static constexpr std::uint32_t CACHE_MAGIC = 0x434d324c; // "L2MC"
+  static constexpr std::uint32_t CACHE_VERSION = 1;
+
+  const std::filesystem::path m_directory;
+
+  auto entry_path(const PackageFile &file) const -> std::filesystem::path;
+};
+
+} // namespace unreal
@@ -3,52 +3,348 @@
 #include <unreal/Archive.h>
 #include <unreal/ArchiveLoader.h>
 
+#include "ArchiveCache.h"
 #include "Decryptor.h"
 
 namespace unreal {
 
-auto ArchiveLoader::load_archive(const std::string &name) const -> Archive * {
-  const auto pair = m_archives.find(name);
+namespace {
 
-  if (pair != m_archives.end()) {
-    return &pair->second;
+auto to_lower(std::string string) -> std::string {
+  std::transform(string.begin(), string.end(), string.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return string;
+}
+
+// Innermost recorder created on the calling thread
+thread_local PackageRecorder *current_recorder = nullptr;
+
+// Calls the function when the scope is left, also by an exception
+template <typename F> class ScopeExit : public utils::NonCopyable {
+public:
+  explicit ScopeExit(F function) : m_function{std::move(function)} {}
+  ~ScopeExit() { m_function(); }
+
+private:
+  F m_function;
+};
+
+} // namespace
+
+PackageRecorder::PackageRecorder()
+    : m_previous{current_recorder}, m_packages{} {
+
+  current_recorder = this;
+}
+
+PackageRecorder::~PackageRecorder() {
+  ASSERT(current_recorder == this, "Unreal",
+         "Package recorders must be destroyed in reverse order");
+  current_recorder = m_previous;
+
+  if (m_previous != nullptr) {
+    m_previous->m_packages.insert(m_packages.begin(), m_packages.end());
   }
+}
+
+void PackageRecorder::record(std::string_view name) {
+  if (current_recorder != nullptr) {
+    current_recorder->m_packages.insert(to_lower(std::string{name}));
+  }
+}
+
+ArchiveLoader::ArchiveLoader(const std::filesystem::path &root_path,
+                             const std::vector<SearchConfig> &configs,
+                             const CacheConfig &cache_config)
+    : m_root_path{root_path}, m_configs{configs},
+      m_memory_budget{cache_config.memory_budget}, m_use_counter{0},
+      m_statistics{}, m_prefetch_pool{PREFETCH_THREAD_COUNT} {
+
+  if (!cache_config.directory.empty()) {
+    m_cache = std::make_unique<ArchiveCache>(cache_config.directory);
+  }
+
+  index_packages();
+}
+
+ArchiveLoader::~ArchiveLoader() {
+  const auto statistics = this->statistics();
 
   utils::Log(utils::LOG_INFO, "Unreal")
-      << "Loading package: " << name << std::endl;
+      << "Package cache: " << statistics.hits << " hits, "
+      << statistics.misses << " misses, " << statistics.evictions
+      << " evictions, " << statistics.resident_bytes / 1024 / 1024
+      << " MB resident" << std::endl;
+}
 
+void ArchiveLoader::index_packages() {
   for (const auto &config : m_configs) {
-    const auto path =
-        m_root_path / config.directory / (name + "." + config.extension);
+    const auto directory = m_root_path / config.directory;
+    const auto extension = to_lower("." + config.extension);
+
+    std::error_code error;
+    std::filesystem::directory_iterator iterator{directory, error};
+
+    if (error) {
+      utils::Log(utils::LOG_WARN, "Unreal")
+          << "Can't read package directory: " << directory << std::endl;
+      continue;
+    }
+
+    for (const auto &entry : iterator) {
+      if (!entry.is_regular_file(error) ||
+          to_lower(entry.path().extension().string()) != extension) {
+        continue;
+      }
+
+      PackageFile file{entry.path(), entry.file_size(error),
+                       entry.last_write_time(error)};
+
+      if (error) {
+        continue;
+      }
+
+      m_package_index.try_emplace(to_lower(entry.path().stem().string()),
+                                  std::move(file));
+    }
+  }
+
+  utils::Log(utils::LOG_INFO, "Unreal")
+      << "Indexed packages: " << m_package_index.size() << std::endl;
+}
+
+auto ArchiveLoader::find_package(const std::string &name) const
+    -> const PackageFile * {
+
+  const auto pair = m_package_index.find(to_lower(name));
+  return pair != m_package_index.end() ? &pair->second : nullptr;
+}
+
+auto ArchiveLoader::load_archive(const std::string &name) const
+    -> std::shared_ptr<Archive> {
+
+  const auto key = to_lower(name);
+  PackageRecorder::record(key);
+
+  std::promise<void> promise;
+
+  while (true) {
+    std::shared_future<void> loaded;
+
+    {
+      const std::lock_guard lock{m_mutex};
+      const auto pair = m_archives.find(key);
+
+      if (pair == m_archives.end()) {
+        m_archives.emplace(key, CachedArchive{promise.get_future().share(),
+                                              nullptr, ++m_use_counter});
+        ++m_statistics.misses;
+        break;
+      }
+
+      loaded = pair->second.loaded;
+    }
+
+    loaded.wait();
+
+    const std::lock_guard lock{m_mutex};
+    const auto pair = m_archives.find(key);
+
+    // Could be evicted right after loading and requested again, wait for the
+    // new load or load it ourselves then
+    if (pair != m_archives.end() &&
+        pair->second.loaded.wait_for(std::chrono::seconds{0}) ==
+            std::future_status::ready) {
+
+      pair->second.last_used = ++m_use_counter;
+      ++m_statistics.hits;
+      return pair->second.archive;
+    }
+  }
+
+  std::shared_ptr<Archive> archive;
+
+  {
+    // Waiters are woken up even if loading throws. Failed loads aren't
+    // cached, so waiters retry them and they aren't counted as hits.
+    const ScopeExit finish_loading{[this, &key, &archive, &promise] {
+      {
+        const std::lock_guard lock{m_mutex};
+
+        if (archive == nullptr) {
+          m_archives.erase(key);
+        } else {
+          m_archives[key].archive = archive;
+          m_statistics.resident_bytes += archive->buffer_size();
+          evict_unused();
+        }
+      }
+
+      promise.set_value();
+    }};
+
+    archive = find_and_load_archive(name);
+  }
+
+  return archive;
+}
+
+auto ArchiveLoader::statistics() const -> CacheStatistics {
+  const std::lock_guard lock{m_mutex};
+  return m_statistics;
+}
+
+void ArchiveLoader::evict_unused() const {
+  if (m_memory_budget == 0 || m_statistics.resident_bytes <= m_memory_budget) {
+    return;
+  }
+
+  // Archive is unused if only the cache holds it and none of its objects
+  // are referenced from the outside, including import caches of other
+  // archives
+  std::vector<std::unordered_map<std::string, CachedArchive>::iterator>
+      candidates;
+
+  for (auto it = m_archives.begin(); it != m_archives.end(); ++it) {
+    const auto &archive = it->second.archive;
+
+    if (archive != nullptr && archive.use_count() == 1 &&
+        !archive->objects_in_use()) {
+
+      candidates.push_back(it);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &a, const auto &b) {
+              return a->second.last_used < b->second.last_used;
+            });
+
+  for (const auto &candidate : candidates) {
+    if (m_statistics.resident_bytes <= m_memory_budget) {
+      break;
+    }
+
+    utils::Log(utils::LOG_DEBUG, "Unreal")
+        << "Evicting package: " << candidate->second.archive->name
+        << std::endl;
+
+    m_statistics.resident_bytes -= candidate->second.archive->buffer_size();
+    ++m_statistics.evictions;
+    m_archives.erase(candidate);
+  }
+}
+
+void ArchiveLoader::prefetch_imports(
+    const Archive &archive, const std::vector<std::string> &extensions) const {
+
+  std::unordered_set<std::string> packages;
+
+  for (const auto &import : archive.import_map) {
+    if (import.package_index == 0 && import.class_name == "Package" &&
+        import.object_name != archive.name) {
+
+      packages.emplace(std::string{import.object_name});
+    }
+  }
+
+  const std::lock_guard lock{m_mutex};
+  collect_prefetches();
+
+  for (const auto &package : packages) {
+    // Script packages like Core or Engine are imported too, but aren't in
+    // the search directories
+    const auto *file = find_package(package);
 
-    if (!std::filesystem::exists(path)) {
+    if (file == nullptr || m_archives.contains(to_lower(package))) {
       continue;
     }
 
-    return load_and_cache_archive(name, path);
+    auto extension = to_lower(file->path.extension().string());
+
+    if (!extension.empty()) {
+      extension.erase(0, 1);
+    }
+
+    if (!extensions.empty() &&
+        std::find(extensions.begin(), extensions.end(), extension) ==
+            extensions.end()) {
+
+      continue;
+    }
+
+    m_prefetches.emplace_back(
+        package, m_prefetch_pool.submit([this, package] {
+          load_archive(package);
+        }));
   }
+}
+
+void ArchiveLoader::collect_prefetches() const {
+  std::erase_if(m_prefetches, [](auto &prefetch) {
+    if (prefetch.second.wait_for(std::chrono::seconds{0}) !=
+        std::future_status::ready) {
+
+      return false;
+    }
+
+    try {
+      prefetch.second.get();
+    } catch (const std::exception &exception) {
+      utils::Log(utils::LOG_WARN, "Unreal")
+          << "Can't prefetch package: " << prefetch.first << ": "
+          << exception.what() << std::endl;
+    }
+
+    return true;
+  });
+}
+
+auto ArchiveLoader::find_and_load_archive(const std::string &name) const
+    -> std::unique_ptr<Archive> {
+
+  utils::Log(utils::LOG_INFO, "Unreal")
+      << "Loading package: " << name << std::endl;
+
+  const auto *file = find_package(name);
+
+  if (file == nullptr) {
+    utils::Log(utils::LOG_WARN, "Unreal")
+        << "Can't find package: " << name << std::endl;
 
-  utils::Log(utils::LOG_WARN, "Unreal")
-      << "Can't find package: " << name << std::endl;
+    return nullptr;
+  }
 
-  return nullptr;
+  return load_archive(name, *file);
 }
 
-auto ArchiveLoader::load_and_cache_archive(
-    const std::string &name, const std::filesystem::path &path) const
-    -> Archive * {
+auto ArchiveLoader::load_archive(const std::string &name,
+                                 const PackageFile &file) const
+    -> std::unique_ptr<Archive> {
+
+  if (m_cache != nullptr) {
+    auto archive = m_cache->load(name, file, *this);
 
-  std::stringstream decrypted;
+    if (archive != nullptr) {
+      utils::Log(utils::LOG_INFO, "Unreal")
+          << "Package loaded from cache: " << name << std::endl;
+      return archive;
+    }
+  }
+
+  std::vector<char> decrypted;
   const Decryptor decryptor;
-  decryptor.decrypt(path, decrypted);
+  decryptor.decrypt(file.path, decrypted);
 
   if (utils::Log::level > utils::LOG_INFO) {
-    dump_decrypted(path, decrypted);
+    dump_decrypted(file.path, decrypted);
   }
 
-  const auto inserted =
-      m_archives.try_emplace(name, name, std::move(decrypted), *this);
-  auto *archive = &inserted.first->second;
+  auto archive = std::make_unique<Archive>(name, std::move(decrypted), *this);
+
+  if (m_cache != nullptr) {
+    m_cache->store(*archive, file);
+  }
 
   utils::Log(utils::LOG_INFO, "Unreal")
       << "Package loaded: " << name
@@ -59,16 +355,17 @@ auto ArchiveLoader::load_and_cache_archive(
 }
 
 void ArchiveLoader::dump_decrypted(const std::filesystem::path &path,
-                                   const std::stringstream &decrypted) const {
+                                   const std::vector<char> &decrypted) const {
 
   auto output_path = path.filename();
   output_path += ".dec";
-  std::ofstream output{output_path};
+  std::ofstream output{output_path, std::ios::binary};
 
   utils::Log(utils::LOG_DEBUG, "Unreal")
       << "Decrypted package: " << output_path << std::endl;
 
-  output << decrypted.str();
+  output.write(decrypted.data(),
+               static_cast<std::streamsize>(decrypted.size()));
 }
 
 } // namespace unreal
@@ -144,7 +144,7 @@ auto operator<<(std::ostream &output, const ObjectLoader &object_loader)
 auto operator<<(std::ostream &output, const Package &package)
     -> std::ostream & {
 
-  return output << package.m_archive;
+  return output << *package.m_archive;
 }
 
 } // namespace unreal
@@ -13,7 +13,7 @@ static constexpr std::array<char, LINEAGE_SIZE> LINEAGE_HEADER = {
     0x00, 0x65, 0x00, 0x32, 0x00, 0x56, 0x00, 0x65, 0x00, 0x72, 0x00};
 
 void Decryptor::decrypt(const std::filesystem::path &path,
-                        std::ostream &output) const {
+                        std::vector<char> &output) const {
 
   std::ifstream input{path, std::ios::binary};
   const auto version = extract_version(input);
@@ -61,23 +61,29 @@ auto Decryptor::extract_version(std::istream &input) const
   return version;
 }
 
-void Decryptor::decrypt_xor(std::istream &input, std::ostream &output,
+void Decryptor::decrypt_xor(std::istream &input, std::vector<char> &output,
                             int key) const {
 
-  std::istreambuf_iterator input_iterator{input};
-  std::ostreambuf_iterator output_iterator{output};
-  std::istreambuf_iterator<char> end;
+  // Read the rest of the file at once and decrypt it in place
+  const auto start = input.tellg();
+  input.seekg(0, std::ios::end);
+  const auto end = input.tellg();
+  input.seekg(start);
 
-  for (auto it = input_iterator; it != end; ++it) {
-    *(output_iterator++) = *it ^ key;
+  output.resize(end - start);
+  input.read(output.data(), static_cast<std::streamsize>(output.size()));
+
+  for (auto &byte : output) {
+    byte = static_cast<char>(byte ^ key);
   }
 }
 
-void Decryptor::decrypt_v111(std::istream &input, std::ostream &output) const {
+void Decryptor::decrypt_v111(std::istream &input,
+                             std::vector<char> &output) const {
   decrypt_xor(input, output, 0xac);
 }
 
-void Decryptor::decrypt_v121(std::istream &input, std::ostream &output,
+void Decryptor::decrypt_v121(std::istream &input, std::vector<char> &output,
                              const std::filesystem::path &path) const {
 
   const auto filename = path.filename().string();
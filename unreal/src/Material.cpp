@@ -129,8 +129,10 @@ void Palette::deserialize() {
 }
 
 auto operator>>(Archive &archive, Mipmap &mipmap) -> Archive & {
-  archive >> mipmap.unknown >> mipmap.data >> mipmap.u_size >> mipmap.v_size >>
-      mipmap.u_bits >> mipmap.v_bits;
+  Index size{};
+  archive >> mipmap.unknown >> size;
+  mipmap.data = archive.view(size);
+  archive >> mipmap.u_size >> mipmap.v_size >> mipmap.u_bits >> mipmap.v_bits;
   return archive;
 }
 
@@ -187,12 +189,7 @@ void Texture::deserialize() {
   Mipmap mip{};
   mip.u_size = u_size;
   mip.v_size = v_size;
-
-  for (auto i = 0; i < size; ++i) {
-    std::uint8_t byte;
-    archive >> byte;
-    mip.data.push_back(byte);
-  }
+  mip.data = archive.view(size);
 
   mips.push_back(mip);
 }
@@ -15,12 +15,13 @@ namespace unreal {
 auto ObjectLoader::load_object(const ObjectImport &import) const
     -> std::shared_ptr<Object> {
 
-  for (auto &object_export : m_archive.export_map) {
-    if (object_export.object_name == import.object_name &&
-        object_export.class_name == import.class_name &&
-        object_export.class_name != "Package") {
+  if (import.class_name != "Package") {
+    for (const auto index : m_archive.class_exports(import.class_name)) {
+      auto &object_export = m_archive.export_map[index];
 
-      return export_object(object_export);
+      if (object_export.object_name == import.object_name) {
+        return export_object(object_export);
+      }
     }
   }
 
@@ -35,7 +36,7 @@ auto ObjectLoader::load_object(Index index) const -> std::shared_ptr<Object> {
   if (index < 0) {
     ASSERT(static_cast<std::size_t>(-index) <= m_archive.import_map.size(),
            "Unreal", "Index out of import_map bounds");
-    const auto &import = m_archive.import_map[-index - 1];
+    auto &import = m_archive.import_map[-index - 1];
 
     ASSERT(import.package_index != 0, "Unreal",
            "Package index can't be equal to zero");
@@ -49,14 +50,37 @@ auto ObjectLoader::load_object(Index index) const -> std::shared_ptr<Object> {
           &m_archive.import_map[-package_import->package_index - 1];
     } while (package_import->package_index != 0);
 
-    const auto *archive =
+    {
+      const std::lock_guard lock{m_mutex};
+
+      if (import.object != nullptr) {
+        // Package isn't requested from the loader, but it's still used
+        PackageRecorder::record(package_import->object_name);
+        return import.object;
+      }
+    }
+
+    // Keeps the package loaded until the object is cached in the import
+    const auto archive =
         m_archive_loader.load_archive(std::string{package_import->object_name});
 
     if (archive == nullptr) {
       return nullptr;
     }
 
-    return archive->object_loader.load_object(import);
+    auto object = archive->object_loader.load_object(import);
+
+    if (object == nullptr) {
+      return nullptr;
+    }
+
+    const std::lock_guard lock{m_mutex};
+
+    if (import.object == nullptr) {
+      import.object = std::move(object);
+    }
+
+    return import.object;
   }
 
   if (index > 0) {
@@ -69,11 +93,24 @@ auto ObjectLoader::load_object(Index index) const -> std::shared_ptr<Object> {
   return nullptr;
 }
 
+auto ObjectLoader::objects_in_use() const -> bool {
+  const std::lock_guard lock{m_mutex};
+
+  return std::any_of(m_archive.export_map.begin(), m_archive.export_map.end(),
+                     [](const ObjectExport &object_export) {
+                       return object_export.object.use_count() > 1;
+                     });
+}
+
 auto ObjectLoader::export_object(ObjectExport &object_export) const
     -> std::shared_ptr<Object> {
 
-  if (object_export.object != nullptr) {
-    return object_export.object;
+  {
+    const std::lock_guard lock{m_mutex};
+
+    if (object_export.object != nullptr) {
+      return object_export.object;
+    }
   }
 
   std::shared_ptr<Object> object;
@@ -122,14 +159,23 @@ auto ObjectLoader::export_object(ObjectExport &object_export) const
   object->name = object_export.object_name;
   object->flags = object_export.object_flags;
 
+  // Threads racing on the same export both deserialize it, the first one to
+  // publish wins and everyone gets that instance. Exports without serialized
+  // data aren't deserialized: every deserialize() only reads from the archive,
+  // so for them it would read whatever follows the shared stream position.
   if (object_export.serial_size > 0) {
-    static_cast<std::istream &>(m_archive).seekg(
-        object_export.serial_offset.value);
+    const auto offset =
+        static_cast<std::size_t>(object_export.serial_offset.value);
+    const ArchiveCursor cursor{m_archive, offset};
+    object->deserialize();
   }
 
-  object->deserialize();
+  const std::lock_guard lock{m_mutex};
+
+  if (object_export.object == nullptr) {
+    object_export.object = std::move(object);
+  }
 
-  object_export.object = object;
   return object_export.object;
 }
 
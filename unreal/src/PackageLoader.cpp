@@ -4,16 +4,22 @@
 
 namespace unreal {
 
-auto PackageLoader::load_package(const std::string &name) const
+auto PackageLoader::load_package(
+    const std::string &name, bool prefetch,
+    const std::vector<std::string> &prefetch_extensions) const
     -> std::optional<Package> {
 
-  auto *archive = m_archive_loader.load_archive(name);
+  auto archive = m_archive_loader.load_archive(name);
 
   if (archive == nullptr) {
     return {};
   }
 
-  return Package{*archive};
+  if (prefetch) {
+    m_archive_loader.prefetch_imports(*archive, prefetch_extensions);
+  }
+
+  return Package{std::move(archive)};
 }
 
 } // namespace unreal
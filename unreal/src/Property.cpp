@@ -8,20 +8,27 @@ auto Property::bool_value() const -> bool {
   return type == PropertyType::Bool && is_array == 1;
 }
 
-auto Property::subproperty(const std::string &name, std::size_t index) const
-    -> Property {
-
-  ASSERT(index < subproperties.size(), "Index out of bounds");
-  const auto &map = subproperties[index];
-  const auto pair = map.find(name);
-
-  if (pair == map.end()) {
-    utils::Log(utils::LOG_WARN, "Unreal")
-        << "Can't find property: " << name << std::endl;
-    return {};
+auto Property::subproperty(std::string_view name, std::size_t index) const
+    -> const Property & {
+
+  static const Property empty{};
+
+  ASSERT(index < subproperty_offsets.size(), "Index out of bounds");
+  const std::size_t begin = subproperty_offsets[index];
+  const std::size_t end = index + 1 < subproperty_offsets.size()
+                              ? subproperty_offsets[index + 1]
+                              : subproperties.size();
+
+  // Search backwards, so the last duplicate wins
+  for (auto i = end; i > begin; --i) {
+    if (subproperties[i - 1].name == name) {
+      return subproperties[i - 1];
+    }
   }
 
-  return pair->second;
+  utils::Log(utils::LOG_WARN, "Unreal")
+      << "Can't find property: " << name << std::endl;
+  return empty;
 }
 
 } // namespace unreal
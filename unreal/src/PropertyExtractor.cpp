@@ -6,23 +6,6 @@
 
 namespace unreal {
 
-auto PropertyExtractor::extract_properties() const -> std::vector<Property> {
-  std::vector<Property> properties;
-
-  while (true) {
-    Property property{};
-    deserialize(property);
-
-    if (property.name == Name::NONE) {
-      break;
-    }
-
-    properties.push_back(std::move(property));
-  }
-
-  return properties;
-}
-
 void PropertyExtractor::deserialize(Property &property) const {
   m_archive >> property.name;
 
@@ -69,20 +52,18 @@ void PropertyExtractor::deserialize(Property &property) const {
     const auto array_size = property.size - size_size;
 
     if (property.name == "Materials") {
-      property.subproperties.reserve(property.array_size);
+      property.subproperty_offsets.reserve(property.array_size);
       const auto array_start_position = input.tellg();
 
       for (auto i = 0; i < property.array_size; ++i) {
-        property.subproperties.push_back(extract_properties_map());
+        extract_subproperties(property);
       }
 
       const auto array_end_position = input.tellg();
       ASSERT((array_end_position - array_start_position) == array_size,
              "Unreal", "Invalid property array");
     } else {
-      property.data_value.resize(array_size);
-      input.read(reinterpret_cast<char *>(property.data_value.data()),
-                 array_size);
+      property.data_value = m_archive.view(array_size);
     }
   } break;
   case PropertyType::Struct: {
@@ -91,7 +72,7 @@ void PropertyExtractor::deserialize(Property &property) const {
     } else if (property.struct_name == "Vector") {
       m_archive >> property.vector_value;
     } else if (property.struct_name == "TerrainLayer") {
-      property.subproperties.push_back(extract_properties_map());
+      extract_subproperties(property);
     } else {
       utils::Log(utils::LOG_DEBUG, "Unreal")
           << "Skipping struct: " << property.struct_name << std::endl;
@@ -151,24 +132,19 @@ auto PropertyExtractor::extract_size(std::uint8_t size_type) const
   return size;
 }
 
-auto PropertyExtractor::extract_properties_map() const
-    -> std::unordered_map<std::string, Property> {
+void PropertyExtractor::extract_subproperties(Property &property) const {
+  property.subproperty_offsets.push_back(
+      static_cast<std::uint32_t>(property.subproperties.size()));
 
-  std::unordered_map<std::string, Property> map;
-  const auto properties = extract_properties();
-
-  for (const auto &property : properties) {
-    const auto name = std::string{property.name};
+  while (true) {
+    auto &subproperty = property.subproperties.emplace_back();
+    deserialize(subproperty);
 
-    if (map.find(name) == map.end()) {
-      utils::Log(utils::LOG_DEBUG, "Unreal")
-          << "Property already exists: " << name << std::endl;
+    if (subproperty.name == Name::NONE) {
+      property.subproperties.pop_back();
+      break;
     }
-
-    map[name] = property;
   }
-
-  return map;
 }
 
 } // namespace unreal
@@ -4,13 +4,16 @@
 #include <utils/Bitset.h>
 #include <utils/Log.h>
 #include <utils/NonCopyable.h>
+#include <utils/StreamBounds.h>
 #include <utils/StreamDump.h>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+#include <algorithm>
 #include <array>
 #include <bitset>
+#include <chrono>
 #include <cctype>
 #include <cstddef>
 #include <cstdint>
@@ -20,8 +23,10 @@
 #include <limits>
 #include <memory>
 #include <optional>
+#include <random>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
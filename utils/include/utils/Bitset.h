@@ -2,19 +2,20 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <span>
 
 namespace utils {
 
+// Non-owning, the viewed data must outlive the bitset
 class Bitset {
 public:
   auto size() const -> std::size_t;
   auto operator[](std::size_t index) const -> bool;
 
-  void insert(const std::vector<std::uint8_t> &data);
+  void insert(std::span<const std::uint8_t> data);
 
 private:
-  std::vector<std::uint8_t> m_data;
+  std::span<const std::uint8_t> m_data;
 };
 
 } // namespace utils
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "NonCopyable.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace utils {
+
+// Blocking FIFO queue of limited capacity for passing work between threads.
+// Once closed, pushes are rejected and pops drain the remaining items.
+template <typename T> class BoundedQueue : public NonCopyable {
+public:
+  explicit BoundedQueue(std::size_t capacity)
+      : m_capacity{capacity > 0 ? capacity : 1}, m_closed{false} {}
+
+  // Blocks while the queue is full, returns false if the queue is closed
+  auto push(T &&item) -> bool {
+    {
+      std::unique_lock lock{m_mutex};
+
+      m_not_full.wait(
+          lock, [this] { return m_closed || m_items.size() < m_capacity; });
+
+      if (m_closed) {
+        return false;
+      }
+
+      m_items.push_back(std::move(item));
+    }
+
+    m_not_empty.notify_one();
+    return true;
+  }
+
+  // Blocks while the queue is empty, returns nothing if the queue is closed
+  // and drained
+  auto pop() -> std::optional<T> {
+    std::optional<T> item;
+
+    {
+      std::unique_lock lock{m_mutex};
+
+      m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+
+      if (m_items.empty()) {
+        return item;
+      }
+
+      item.emplace(std::move(m_items.front()));
+      m_items.pop_front();
+    }
+
+    m_not_full.notify_one();
+    return item;
+  }
+
+  void close() {
+    {
+      const std::lock_guard lock{m_mutex};
+      m_closed = true;
+    }
+
+    m_not_full.notify_all();
+    m_not_empty.notify_all();
+  }
+
+private:
+  const std::size_t m_capacity;
+
+  std::mutex m_mutex;
+  std::condition_variable m_not_full;
+  std::condition_variable m_not_empty;
+  std::deque<T> m_items;
+  bool m_closed;
+};
+
+} // namespace utils
@@ -6,9 +6,21 @@
 
 #include <cstdint>
 #include <istream>
+#include <type_traits>
 
 namespace utils {
 
+// Specialize for types whose in-memory layout matches their little-endian
+// on-disk layout, arrays of them are read with a single read call on
+// little-endian hosts
+template <typename T>
+struct is_bulk_extractable
+    : std::bool_constant<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>> {
+};
+
+template <typename T>
+inline constexpr bool is_bulk_extractable_v = is_bulk_extractable<T>::value;
+
 // std::istream packed_endian_specific_integral extraction
 template <typename value_type, llvm::endianness endian, llvm::alignment align>
 auto operator>>(
@@ -55,12 +67,28 @@ struct ExtractArrayHelper {
     const std::int32_t size = size_value;
 
     ASSERT(size >= 0, "Utils", "Size can't be negative: " << size);
-    store_to.reserve(size);
 
-    for (auto i = 0; i < size; ++i) {
-      ExtractElementAsT element{};
-      input_stream >> element;
-      store_to.push_back(element);
+    if constexpr (is_bulk_extractable_v<ExtractElementAsT> &&
+                  std::is_trivially_copyable_v<ExtractElementAsT> &&
+                  std::is_same_v<ExtractElementAsT,
+                                 typename StoreToT::value_type> &&
+                  llvm::endian::system_endianness() == llvm::little) {
+
+      store_to.resize(size);
+
+      if (size > 0) {
+        static_cast<std::istream &>(input_stream)
+            .read(reinterpret_cast<char *>(store_to.data()),
+                  size * sizeof(ExtractElementAsT));
+      }
+    } else {
+      store_to.reserve(size);
+
+      for (auto i = 0; i < size; ++i) {
+        ExtractElementAsT element{};
+        input_stream >> element;
+        store_to.push_back(element);
+      }
     }
 
     return input_stream;
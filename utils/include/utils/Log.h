@@ -1,6 +1,7 @@
 #pragma once
 
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <unordered_set>
 
@@ -18,6 +19,8 @@ enum LogLevel {
   LOG_ALL,
 };
 
+// Lines are buffered and written at once, so lines logged from different
+// threads don't interleave
 class Log {
 public:
   using endl_type = decltype(std::endl<char, std::char_traits<char>>);
@@ -27,12 +30,13 @@ public:
   inline static bool colored = true;
 
   Log(LogLevel log_level, const std::string &space = "");
+  ~Log();
 
   auto operator<<(endl_type endl) -> Log &;
 
   template <typename T> auto operator<<(const T &value) -> Log & {
     if (check_filter()) {
-      m_output << value;
+      m_line << value;
     }
 
     return *this;
@@ -62,6 +66,9 @@ private:
   const LogLevel m_log_level;
   const std::string m_space;
   std::ostream &m_output;
+  std::ostringstream m_line;
+
+  void flush();
 
   auto log_level_prefix() const -> std::string;
   auto check_filter() const -> bool;
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+namespace utils {
+
+// Highest resident memory of the whole process so far in bytes, 0 if the
+// platform doesn't report it
+auto peak_resident_memory() -> std::size_t;
+
+} // namespace utils
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <ios>
+#include <streambuf>
+
+namespace utils {
+
+// Read-only seekable stream buffer over memory owned by someone else
+class MemoryStreamBuffer : public std::streambuf {
+public:
+  explicit MemoryStreamBuffer(const char *data, std::size_t size);
+
+protected:
+  auto seekoff(off_type offset, std::ios_base::seekdir direction,
+               std::ios_base::openmode mode) -> pos_type override;
+  auto seekpos(pos_type position, std::ios_base::openmode mode)
+      -> pos_type override;
+};
+
+} // namespace utils
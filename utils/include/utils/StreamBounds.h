@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+
+namespace utils {
+
+// Sizes read from files are checked against the remaining bytes before
+// anything is allocated. Fails the input if the elements can't fit.
+inline auto fits(std::istream &input, std::uint64_t input_size,
+                 std::uint64_t count, std::size_t element_size) -> bool {
+
+  if (!input) {
+    return false;
+  }
+
+  const auto position = static_cast<std::uint64_t>(input.tellg());
+
+  if (position > input_size || count > (input_size - position) / element_size) {
+    input.setstate(std::ios::failbit);
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace utils
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "NonCopyable.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+// Fixed set of worker threads executing tasks in submission order. Tasks
+// still queued on destruction are dropped, running ones are joined.
+class ThreadPool : public NonCopyable {
+public:
+  explicit ThreadPool(std::size_t thread_count);
+  ~ThreadPool();
+
+  template <typename F>
+  auto submit(F &&function) -> std::future<std::invoke_result_t<F>> {
+    using ResultT = std::invoke_result_t<F>;
+
+    auto task = std::make_shared<std::packaged_task<ResultT()>>(
+        std::forward<F>(function));
+    auto future = task->get_future();
+
+    {
+      const std::lock_guard lock{m_mutex};
+      m_tasks.emplace_back([task] { (*task)(); });
+    }
+
+    m_condition.notify_one();
+    return future;
+  }
+
+  auto thread_count() const -> std::size_t { return m_threads.size(); }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<std::function<void()>> m_tasks;
+  bool m_stopped;
+
+  std::vector<std::thread> m_threads;
+
+  void work();
+};
+
+} // namespace utils
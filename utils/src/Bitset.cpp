@@ -18,6 +18,6 @@ auto Bitset::operator[](std::size_t index) const -> bool {
   return (bits & (1 << bit_index)) != 0;
 }
 
-void Bitset::insert(const std::vector<std::uint8_t> &data) { m_data = data; }
+void Bitset::insert(std::span<const std::uint8_t> data) { m_data = data; }
 
 } // namespace utils
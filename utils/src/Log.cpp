@@ -1,29 +1,49 @@
 #include <utils/Log.h>
 
 #include <iostream>
+#include <mutex>
 
 namespace utils {
 
+static std::mutex output_mutex;
+
 Log::Log(LogLevel log_level, const std::string &space)
-    : m_log_level{log_level}, m_space{space}, m_output{std::cout} {
+    : m_log_level{log_level}, m_space{space}, m_output{std::cout}, m_line{} {
 
   if (check_filter()) {
     if (m_space.empty()) {
-      m_output << log_level_prefix() << ": ";
+      m_line << log_level_prefix() << ": ";
     } else {
-      m_output << log_level_prefix() << " (" << m_space << "): ";
+      m_line << log_level_prefix() << " (" << m_space << "): ";
     }
   }
 }
 
+Log::~Log() {
+  // Line without trailing std::endl
+  if (m_line.tellp() > 0) {
+    flush();
+  }
+}
+
 auto Log::operator<<(endl_type endl) -> Log & {
   if (check_filter()) {
-    m_output << ansi_color(Color::Clear) << endl;
+    m_line << ansi_color(Color::Clear) << endl;
+    flush();
   }
 
   return *this;
 }
 
+void Log::flush() {
+  {
+    const std::lock_guard lock{output_mutex};
+    m_output << m_line.str() << std::flush;
+  }
+
+  m_line.str("");
+}
+
 auto Log::log_level_prefix() const -> std::string {
   switch (m_log_level) {
   case LOG_FATAL: {
@@ -0,0 +1,41 @@
+#include <utils/Memory.h>
+
+#if _WIN32
+#define NOMINMAX
+#include <windows.h>
+
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace utils {
+
+auto peak_resident_memory() -> std::size_t {
+#if _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                            sizeof(counters))) {
+
+    return 0;
+  }
+
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+
+#if __APPLE__
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+  // Kilobytes on Linux
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+} // namespace utils
@@ -0,0 +1,50 @@
+#include <utils/MemoryStreamBuffer.h>
+
+namespace utils {
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char *data, std::size_t size) {
+  // std::streambuf requires non-const pointers, but we never write
+  auto *begin = const_cast<char *>(data);
+  setg(begin, begin, begin + size);
+}
+
+auto MemoryStreamBuffer::seekoff(off_type offset,
+                                 std::ios_base::seekdir direction,
+                                 std::ios_base::openmode mode) -> pos_type {
+
+  if ((mode & std::ios_base::in) == 0) {
+    return pos_type(off_type(-1));
+  }
+
+  off_type position = 0;
+
+  switch (direction) {
+  case std::ios_base::beg: {
+    position = offset;
+  } break;
+  case std::ios_base::cur: {
+    position = (gptr() - eback()) + offset;
+  } break;
+  case std::ios_base::end: {
+    position = (egptr() - eback()) + offset;
+  } break;
+  default: {
+    return pos_type(off_type(-1));
+  }
+  }
+
+  if (position < 0 || position > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+
+  setg(eback(), eback() + position, egptr());
+  return pos_type(position);
+}
+
+auto MemoryStreamBuffer::seekpos(pos_type position,
+                                 std::ios_base::openmode mode) -> pos_type {
+
+  return seekoff(off_type(position), std::ios_base::beg, mode);
+}
+
+} // namespace utils
@@ -0,0 +1,47 @@
+#include <utils/ThreadPool.h>
+
+namespace utils {
+
+ThreadPool::ThreadPool(std::size_t thread_count) : m_stopped{false} {
+  m_threads.reserve(thread_count);
+
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    m_threads.emplace_back([this] { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    const std::lock_guard lock{m_mutex};
+    m_stopped = true;
+    m_tasks.clear();
+  }
+
+  m_condition.notify_all();
+
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock lock{m_mutex};
+      m_condition.wait(lock, [this] { return m_stopped || !m_tasks.empty(); });
+
+      if (m_stopped) {
+        return;
+      }
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+} // namespace utils